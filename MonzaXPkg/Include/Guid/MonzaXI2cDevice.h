@@ -25,6 +25,22 @@ SOFTWARE.
 #ifndef _MONZAX_I2C_DEVICE_H_
 #define _MONZAX_I2C_DEVICE_H_
 
+#include <Protocol/DevicePath.h>
+
 extern EFI_GUID gMonzaXI2cDeviceGuid;
 
+//
+// Device path node appended by the I2C MonzaX driver to the I2C device path
+// for every chip it exposes. Vendor.Guid is gMonzaXI2cDeviceGuid. MuxChannel
+// is the I2C multiplexer channel of the chip, MONZAX_MUX_CHANNEL_NONE if the
+// chip is not behind a multiplexer.
+//
+#pragma pack(1)
+typedef struct {
+  VENDOR_DEVICE_PATH            Vendor;
+  UINT8                         I2cDeviceId;
+  UINT8                         MuxChannel;
+} MONZAX_I2C_DEVICE_PATH;
+#pragma pack()
+
 #endif
@@ -26,7 +26,111 @@ SOFTWARE.
 #define _MONZAX_LIB_H_
 
 #include <Uefi.h>
+#include <Library/UefiLib.h>
 #include <Protocol/MonzaXIo.h>
+#include <Protocol/MonzaXTrace.h>
+
+//
+// Transfer tracing of the MonzaX drivers into a ring of
+// MONZAX_TRACE_RING_SIZE entries. Count is the number of entries ever
+// recorded, the next entry goes to Count % MONZAX_TRACE_RING_SIZE.
+//
+#define MONZAX_TRACE_RING_SIZE      64
+
+#define MONZAX_TRACE_RING_SIGNATURE SIGNATURE_32 ('m', 'z', 'x', 't')
+
+typedef struct {
+  UINTN                         Signature;
+  MONZAX_TRACE_PROTOCOL         Protocol;
+  MONZAX_TRACE_ENTRY            Entries[MONZAX_TRACE_RING_SIZE];
+  UINTN                         Count;
+  UINT64                        CounterStart;
+  UINT64                        CounterEnd;
+} MONZAX_TRACE_RING;
+
+//
+// The macros take a device with a MONZAX_TRACE_RING named Trace, and
+// compile to nothing when MDEPKG_NDEBUG is defined, as in RELEASE builds.
+//
+#ifdef MDEPKG_NDEBUG
+#define MONZAX_TRACE_ENABLED      FALSE
+#define MONZAX_TRACE_BEGIN()      0
+#define MONZAX_TRACE(Dev, OpCode, Slave, Address, Length, Status, Start) \
+          ((VOID)(Start))
+#else
+#define MONZAX_TRACE_ENABLED      TRUE
+#define MONZAX_TRACE_BEGIN()      GetPerformanceCounter ()
+#define MONZAX_TRACE(Dev, OpCode, Slave, Address, Length, Status, Start) \
+          MonzaxTraceRecord (&(Dev)->Trace, (OpCode), (Slave), (Address), (Length), (Status), (Start))
+#endif
+
+//
+// The chip model of a MonzaX device is identified from the TID on first
+// use, or by a one-shot timer MONZAX_PROBE_DELAY after Start, whichever
+// comes first. The TID of a 2K Dura starts MONZAX_TID_OFFSET_2K bytes into
+// its TID bank.
+//
+#define MONZAX_PROBE_DELAY        EFI_TIMER_PERIOD_MILLISECONDS (100)
+#define MONZAX_TID_CLASS_ID_GEN2  0xE2
+#define MONZAX_TID_OFFSET_2K      0x10
+#define MONZAX_TID_OFFSET_8K      0x00
+
+#define MONZAX_PERF_TOKEN_PROBE   "MonzaX:Probe"
+
+typedef enum {
+  MonzaXProbePending,
+  MonzaXProbeRunning,
+  MonzaXProbeDone,
+  MonzaXProbeFailed
+} MONZAX_PROBE_STATE;
+
+/**
+
+  Read the chip of a driver with the address layout of the model being
+  tried, for the probe.
+
+  @param Context    The context of the probe.
+  @param Address    The memory address.
+  @param Data       The buffer to hold the data.
+  @param DataLen    The number of bytes to read.
+
+  @return The number of bytes read.
+
+**/
+typedef
+UINTN
+(EFIAPI *MONZAX_PROBE_READ) (
+  IN  VOID                  *Context,
+  IN  UINT16                Address,
+  OUT UINT8                 *Data,
+  IN  UINTN                 DataLen
+  );
+
+/**
+
+  Tell the driver that the probe is over.
+
+  @param Context    The context of the probe.
+  @param Status     EFI_SUCCESS if the chip model is identified.
+
+**/
+typedef
+VOID
+(EFIAPI *MONZAX_PROBE_DONE) (
+  IN  VOID                  *Context,
+  IN  EFI_STATUS            Status
+  );
+
+typedef struct {
+  MONZAX_PROBE_STATE            State;
+  EFI_EVENT                     Event;
+  EFI_HANDLE                    *Handle;
+  EFI_LOCK                      *Lock;
+  MONZAX_CHIP_MODEL_TYPE        *ChipModelType;
+  MONZAX_PROBE_READ             Read;
+  MONZAX_PROBE_DONE             Done;
+  VOID                          *Context;
+} MONZAX_PROBE;
 
 /**
 
@@ -752,4 +856,147 @@ MonzaxLockI2cDeviceId (
   IN MONZAX_IO_PROTOCOL     *MonzaXIo
   );
 
+/**
+
+  Set up a trace ring and the MONZAX_TRACE_PROTOCOL that reads it.
+
+  @param Ring       The trace ring.
+
+**/
+VOID
+EFIAPI
+MonzaxTraceInit (
+  OUT MONZAX_TRACE_RING     *Ring
+  );
+
+/**
+
+  Get the performance counter ticks elapsed since a start value.
+
+  @param Ring       The trace ring, which holds the range of the counter.
+  @param Start      The performance counter at the start.
+  @param End        The performance counter at the end.
+
+  @return The ticks elapsed. The counter is assumed to wrap at most once.
+
+**/
+UINT64
+EFIAPI
+MonzaxGetElapsedTicks (
+  IN MONZAX_TRACE_RING      *Ring,
+  IN UINT64                 Start,
+  IN UINT64                 End
+  );
+
+/**
+
+  Record a transfer into a trace ring. Use MONZAX_TRACE instead, which
+  compiles to nothing in RELEASE builds.
+
+  @param Ring       The trace ring.
+  @param OpCode     The MONZAX_TRACE_OPCODE of the transfer.
+  @param Slave      The 7-bit I2C address, 0 for reports.
+  @param Address    The memory address, or the report ID.
+  @param Length     The number of bytes transferred.
+  @param Status     The status of the transfer.
+  @param Start      The performance counter at the start of the transfer.
+
+**/
+VOID
+EFIAPI
+MonzaxTraceRecord (
+  IN MONZAX_TRACE_RING      *Ring,
+  IN MONZAX_TRACE_OPCODE    OpCode,
+  IN UINT8                  Slave,
+  IN UINT16                 Address,
+  IN UINTN                  Length,
+  IN EFI_STATUS             Status,
+  IN UINT64                 Start
+  );
+
+/**
+
+  Identify the chip model from the class ID and model number in its TID.
+
+  @param Read           Reads the chip with the address layout of *ChipModelType.
+  @param Context        The context passed to Read.
+  @param ChipModelType  On input, the model assumed so far. On output, the
+                        model of the chip, or the input value if none answered.
+
+  @retval EFI_SUCCESS       *ChipModelType holds the model of the chip.
+  @retval EFI_NOT_FOUND     No MonzaX chip answered.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaxDetectChipModel (
+  IN MONZAX_PROBE_READ          Read,
+  IN VOID                       *Context,
+  IN OUT MONZAX_CHIP_MODEL_TYPE *ChipModelType
+  );
+
+/**
+
+  Set up the probe of a MonzaX device and create its timer. The caller
+  starts the timer with MONZAX_PROBE_DELAY once the device is published,
+  and closes Probe->Event when the device goes away.
+
+  @param Probe          The probe.
+  @param Handle         The handle the PERF records of the probe are made
+                        on. It is read when the probe runs, so it may be
+                        filled in after this call.
+  @param Lock           The lock of the transfers to the chip.
+  @param ChipModelType  The chip model of the device.
+  @param Read           Reads the chip with the address layout of *ChipModelType.
+  @param Done           Called once the chip is identified, or not.
+  @param Context        The context passed to Read and Done.
+
+  @retval EFI_SUCCESS   The probe is pending.
+  @return Others        The timer cannot be created.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaxProbeInit (
+  OUT MONZAX_PROBE              *Probe,
+  IN EFI_HANDLE                 *Handle,
+  IN EFI_LOCK                   *Lock,
+  IN MONZAX_CHIP_MODEL_TYPE     *ChipModelType,
+  IN MONZAX_PROBE_READ          Read,
+  IN MONZAX_PROBE_DONE          Done,
+  IN VOID                       *Context
+  );
+
+/**
+
+  Identify the chip model if it is not known yet. The caller holds
+  Probe->Lock.
+
+  @param Probe      The probe.
+
+  @retval EFI_SUCCESS       *Probe->ChipModelType holds the model of the chip.
+  @retval EFI_NOT_FOUND     No MonzaX chip answered.
+  @retval EFI_NOT_READY     The chip is being identified by an interrupted caller.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaxProbe (
+  IN MONZAX_PROBE               *Probe
+  );
+
+/**
+
+  Take the chip model as known, without reading the chip. The caller holds
+  Probe->Lock.
+
+  @param Probe      The probe.
+
+**/
+VOID
+EFIAPI
+MonzaxProbeSetDone (
+  IN MONZAX_PROBE               *Probe
+  );
+
 #endif
@@ -26,7 +26,16 @@ SOFTWARE.
 #define _MONZAX_IO_H_
 
 #define MONZAX_IO_PROTOCOL_GUID \
-  { 0x56ec4783, 0x9d61, 0x49c5, 0x8c, 0x18, 0x17, 0x72, 0x35, 0x69, 0x93, 0xb6 }
+  { 0x7ab24aa7, 0xf661, 0x4579, 0x9d, 0xa4, 0xf1, 0x7d, 0xca, 0xb2, 0xef, 0x49 }
+
+//
+// Revision 1 provides GetInfo, SetInfo, Read and Write. Revision 2 adds
+// ReadAsync, WriteAsync and InvalidateCache. Later revisions only append
+// members, so callers check Revision before using anything past Write.
+//
+#define MONZAX_IO_PROTOCOL_REVISION_1   0x00010000
+#define MONZAX_IO_PROTOCOL_REVISION_2   0x00020000
+#define MONZAX_IO_PROTOCOL_REVISION     MONZAX_IO_PROTOCOL_REVISION_2
 
 typedef struct _MONZAX_IO_PROTOCOL MONZAX_IO_PROTOCOL;
 
@@ -36,6 +45,13 @@ typedef struct _MONZAX_IO_PROTOCOL MONZAX_IO_PROTOCOL;
 #define MONZAX_I2C_DEVICE_ID_4          0x6E
 #define MONZAX_I2C_DEVICE_ID_DEFAULT    0x6E
 
+//
+// Channels of a PCA954x style I2C multiplexer in front of the chips. The
+// control register of the multiplexer takes one enable bit per channel.
+//
+#define MONZAX_MUX_CHANNEL_MAX          8
+#define MONZAX_MUX_CHANNEL_NONE         0xFF
+
 #define MONZAX_SIZE_BYTES_RESERVED   22
 #define MONZAX_SIZE_BYTES_EPC        18
 #define MONZAX_SIZE_BYTES_TID        24
@@ -49,6 +65,17 @@ typedef struct _MONZAX_IO_PROTOCOL MONZAX_IO_PROTOCOL;
 #define MONZAX_BASE_ADDRESS_TID_2K     0x138
 #define MONZAX_BASE_ADDRESS_TID_8K     0x28
 
+//
+// Size of the whole address space, up to the end of the last bank.
+//
+#define MONZAX_SIZE_BYTES_MEMORY_2K    (MONZAX_BASE_ADDRESS_TID_2K + MONZAX_SIZE_BYTES_TID)
+#define MONZAX_SIZE_BYTES_MEMORY_8K    (MONZAX_BASE_ADDRESS_USER_8K + MONZAX_SIZE_BYTES_USER_8K)
+
+//
+// A single I2C write transaction must not cross a write page boundary.
+//
+#define MONZAX_SIZE_BYTES_WRITE_PAGE   16
+
 typedef enum {
   MonzaXMemoryBankReserved,
   MonzaXMemoryBankEpc,
@@ -66,9 +93,52 @@ typedef struct {
   UINT32                  Length;
   MONZAX_CHIP_MODEL_TYPE  ChipModelType;
   UINT8                   I2cDeviceId;
+  //
+  // Fields below are added in revision 0x2. They report the active bus
+  // configuration and are ignored by SetInfo. A value of 0 means unknown
+  // or not limited.
+  //
+  UINT32                  BusFrequency;   // in Hz
+  UINT16                  WriteTimeout;   // in ms
+  UINT16                  ReadTimeout;    // in ms
+  UINT16                  RetryLimit;
+  BOOLEAN                 SclLowTimeout;
+  //
+  // Fields below are added in revision 0x3. They count the reads served by
+  // the driver memory cache and the reads that went to the bus. Both stay 0
+  // when the cache is disabled. They are ignored by SetInfo.
+  //
+  UINT32                  CacheHits;
+  UINT32                  CacheMisses;
+  //
+  // Fields below are added in revision 0x4. They count the MonzaX IO reads
+  // and writes, and the transfers they issued on the transport: I2C
+  // requests or CP2112 interrupt transfers. They are ignored by SetInfo.
+  //
+  UINT32                  IoCalls;
+  UINT32                  BusTransfers;
+  //
+  // Field below is added in revision 0x5. It is the I2C multiplexer channel
+  // of the chip, MONZAX_MUX_CHANNEL_NONE if there is no multiplexer. SetInfo
+  // takes it when the driver has a multiplexer.
+  //
+  UINT8                   MuxChannel;
 } MONZAX_INFO;
 
-#define MONZAX_INFO_REVISION 0x1
+#define MONZAX_INFO_REVISION_1 0x1
+#define MONZAX_INFO_REVISION_2 0x2
+#define MONZAX_INFO_REVISION_3 0x3
+#define MONZAX_INFO_REVISION_4 0x4
+#define MONZAX_INFO_REVISION_5 0x5
+#define MONZAX_INFO_REVISION   MONZAX_INFO_REVISION_5
+
+//
+// Size of the older structures, still accepted by GetInfo and SetInfo.
+//
+#define MONZAX_INFO_REVISION_1_LENGTH  OFFSET_OF (MONZAX_INFO, BusFrequency)
+#define MONZAX_INFO_REVISION_2_LENGTH  OFFSET_OF (MONZAX_INFO, CacheHits)
+#define MONZAX_INFO_REVISION_3_LENGTH  OFFSET_OF (MONZAX_INFO, IoCalls)
+#define MONZAX_INFO_REVISION_4_LENGTH  OFFSET_OF (MONZAX_INFO, MuxChannel)
 
 /**
 
@@ -80,6 +150,10 @@ typedef struct {
   @retval EFI_SUCCESS            The MonzaX information structure is returned.
   @retval EFI_INVALID_PARAMETER  Info is NULL.
   @retval EFI_BUFFER_TOO_SMALL   The Info buffer is too small to hold the full data.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+  @retval EFI_NOT_READY          The chip model is being identified by an interrupted caller.
+
+  A caller built against an older revision only gets the fields of that revision.
 
 **/
 typedef
@@ -98,6 +172,7 @@ EFI_STATUS
 
   @retval EFI_SUCCESS            The MonzaX information is set.
   @retval EFI_INVALID_PARAMETER  Info is NULL.
+  @retval EFI_INVALID_PARAMETER  Info->MuxChannel is not a channel of the multiplexer.
 
 **/
 typedef
@@ -122,6 +197,7 @@ EFI_STATUS
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Read data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 typedef
@@ -148,6 +224,7 @@ EFI_STATUS
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Write data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 typedef
@@ -159,11 +236,113 @@ EFI_STATUS
   IN  OUT UINTN                      *DataLen
   );
 
+//
+// Completion token of an asynchronous read or write.
+//
+typedef struct {
+  //
+  // Signaled when the transfer completes. It must not be NULL.
+  //
+  EFI_EVENT                          Event;
+  //
+  // The status of the transfer, valid once Event is signaled.
+  //
+  EFI_STATUS                         TransactionStatus;
+  //
+  // The number of bytes of the data buffer transferred, valid once Event is signaled.
+  //
+  UINTN                              DataLength;
+} MONZAX_IO_TOKEN;
+
+/**
+
+  Start reading data from MonzaX chip.
+
+  The request is queued behind the other asynchronous requests of the device.
+  Data must stay valid until Token->Event is signaled.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the read completes.
+
+  @retval EFI_SUCCESS            The read is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+  @retval EFI_OUT_OF_RESOURCES   The request cannot be queued.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_IO_READ_ASYNC) (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  OUT UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  );
+
+/**
+
+  Start writing data to MonzaX chip.
+
+  The request is queued behind the other asynchronous requests of the device.
+  Data must stay valid until Token->Event is signaled.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is written to.
+  @param Data       A pointer to the buffer of data that will be written to MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the write completes.
+
+  @retval EFI_SUCCESS            The write is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+  @retval EFI_OUT_OF_RESOURCES   The request cannot be queued.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_IO_WRITE_ASYNC) (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  );
+
+/**
+
+  Drop cached MonzaX memory contents so that the next read goes to the chip.
+
+  Writes through this protocol keep the cache up to date. This is only needed
+  when the memory may have been changed by other means, e.g. over RF.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of the first byte to drop.
+  @param DataLen    The number of bytes to drop. 0 drops the whole cache.
+
+  @retval EFI_SUCCESS            The range is no longer cached.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_IO_INVALIDATE_CACHE) (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINTN                          DataLen
+  );
+
 struct _MONZAX_IO_PROTOCOL {
+  UINT64                             Revision;
   MONZAX_IO_GET_INFO                 GetInfo;
   MONZAX_IO_SET_INFO                 SetInfo;
   MONZAX_IO_READ                     Read;
   MONZAX_IO_WRITE                    Write;
+  MONZAX_IO_READ_ASYNC               ReadAsync;
+  MONZAX_IO_WRITE_ASYNC              WriteAsync;
+  MONZAX_IO_INVALIDATE_CACHE         InvalidateCache;
 };
 
 extern EFI_GUID gMonzaXIoProtocolGuid;
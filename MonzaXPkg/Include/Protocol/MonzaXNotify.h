@@ -0,0 +1,105 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+#ifndef _MONZAX_NOTIFY_H_
+#define _MONZAX_NOTIFY_H_
+
+#define MONZAX_NOTIFY_PROTOCOL_GUID \
+  { 0x1ba2359d, 0x320f, 0x4631, 0xba, 0xba, 0x0a, 0x83, 0xf3, 0x10, 0x53, 0x07 }
+
+//
+// Edge notification of the Monza X wake / RF busy output, wired to a GPIO of
+// the USB bridge. It is only installed when the driver watches such a pin.
+//
+typedef struct _MONZAX_NOTIFY_PROTOCOL MONZAX_NOTIFY_PROTOCOL;
+
+/**
+
+  Register an event to be signaled on every edge of the wake pin.
+  Edges are only watched for while an event is registered.
+
+  @param This       Pointer to the MONZAX_NOTIFY_PROTOCOL instance.
+  @param Event      The event to signal.
+
+  @retval EFI_SUCCESS            The event is registered.
+  @retval EFI_INVALID_PARAMETER  Event is NULL.
+  @retval EFI_ALREADY_STARTED    The event is already registered.
+  @retval EFI_OUT_OF_RESOURCES   The event cannot be registered.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_NOTIFY_REGISTER) (
+  IN  MONZAX_NOTIFY_PROTOCOL         *This,
+  IN  EFI_EVENT                      Event
+  );
+
+/**
+
+  Unregister an event registered by Register.
+
+  @param This       Pointer to the MONZAX_NOTIFY_PROTOCOL instance.
+  @param Event      The event to unregister.
+
+  @retval EFI_SUCCESS            The event is no longer signaled.
+  @retval EFI_NOT_FOUND          The event is not registered.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_NOTIFY_UNREGISTER) (
+  IN  MONZAX_NOTIFY_PROTOCOL         *This,
+  IN  EFI_EVENT                      Event
+  );
+
+/**
+
+  Get the level of the wake pin.
+
+  @param This       Pointer to the MONZAX_NOTIFY_PROTOCOL instance.
+  @param Level      TRUE if the pin is high.
+  @param EdgeCount  Optional. The number of edges seen while an event was
+                    registered.
+
+  @retval EFI_SUCCESS            The state is returned.
+  @retval EFI_INVALID_PARAMETER  Level is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_NOTIFY_GET_STATE) (
+  IN  MONZAX_NOTIFY_PROTOCOL         *This,
+  OUT BOOLEAN                        *Level,
+  OUT UINT32                         *EdgeCount OPTIONAL
+  );
+
+struct _MONZAX_NOTIFY_PROTOCOL {
+  MONZAX_NOTIFY_REGISTER             Register;
+  MONZAX_NOTIFY_UNREGISTER           Unregister;
+  MONZAX_NOTIFY_GET_STATE            GetState;
+};
+
+extern EFI_GUID gMonzaXNotifyProtocolGuid;
+
+#endif
@@ -0,0 +1,127 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+#ifndef _MONZAX_SCHEDULER_H_
+#define _MONZAX_SCHEDULER_H_
+
+#include <Protocol/MonzaXIo.h>
+
+#define MONZAX_SCHEDULER_PROTOCOL_GUID \
+  { 0xb93f9785, 0x9811, 0x4dcc, 0x93, 0x7f, 0x55, 0xd9, 0x86, 0x87, 0x82, 0x42 }
+
+//
+// Work scheduler of a MonzaX driver, installed on the driver image handle.
+// Each device the driver manages has its own work queue. Run interleaves the
+// bus transfers of the queues, so that one device waiting for its bridge or
+// for a write cycle of its chip does not hold up the others. Reads of
+// several devices are on their buses at the same time. A write page is
+// confirmed before the next device gets its turn, so only the write cycles
+// of the chips overlap, not the write transfers.
+//
+typedef struct _MONZAX_SCHEDULER_PROTOCOL MONZAX_SCHEDULER_PROTOCOL;
+
+/**
+
+  Get the MonzaX IO instances of the devices managed by the driver.
+
+  @param This         Pointer to the MONZAX_SCHEDULER_PROTOCOL instance.
+  @param DeviceCount  On input, the number of entries Devices can hold.
+                      On output, the number of devices.
+  @param Devices      The buffer to hold the MonzaX IO instances.
+
+  @retval EFI_SUCCESS            The devices are returned.
+  @retval EFI_INVALID_PARAMETER  DeviceCount is NULL, or Devices is NULL and *DeviceCount is not 0.
+  @retval EFI_BUFFER_TOO_SMALL   Devices cannot hold all the devices. *DeviceCount is updated.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_SCHEDULER_GET_DEVICES) (
+  IN  MONZAX_SCHEDULER_PROTOCOL      *This,
+  IN OUT UINTN                       *DeviceCount,
+  OUT MONZAX_IO_PROTOCOL             **Devices
+  );
+
+/**
+
+  Queue a read or a write to the work queue of a device.
+
+  Nothing is transferred until Run is called. Data must stay valid until
+  Token->Event is signaled.
+
+  @param This       Pointer to the MONZAX_SCHEDULER_PROTOCOL instance.
+  @param MonzaXIo   The MonzaX IO instance of the device, from GetDevices.
+  @param Write      TRUE to write Data to the chip, FALSE to read into Data.
+  @param Address    The device address of MonzaX chip of the first byte.
+  @param Data       The data buffer.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the transfer completes.
+
+  @retval EFI_SUCCESS            The transfer is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLen is 0.
+  @retval EFI_NOT_FOUND          MonzaXIo is not a device of the driver.
+  @retval EFI_OUT_OF_RESOURCES   The transfer cannot be queued.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_SCHEDULER_SUBMIT) (
+  IN  MONZAX_SCHEDULER_PROTOCOL      *This,
+  IN  MONZAX_IO_PROTOCOL             *MonzaXIo,
+  IN  BOOLEAN                        Write,
+  IN  UINT16                         Address,
+  IN  UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  );
+
+/**
+
+  Run the work queues of all devices until they are empty.
+
+  The queues take turns, one bus transfer each. The token of every transfer
+  is signaled as it completes, in the same way as the asynchronous MonzaX IO
+  calls report their result.
+
+  @param This       Pointer to the MONZAX_SCHEDULER_PROTOCOL instance.
+
+  @retval EFI_SUCCESS            All queued transfers are completed.
+  @retval EFI_ALREADY_STARTED    Run is called from a token of a running Run.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_SCHEDULER_RUN) (
+  IN  MONZAX_SCHEDULER_PROTOCOL      *This
+  );
+
+struct _MONZAX_SCHEDULER_PROTOCOL {
+  MONZAX_SCHEDULER_GET_DEVICES       GetDevices;
+  MONZAX_SCHEDULER_SUBMIT            Submit;
+  MONZAX_SCHEDULER_RUN               Run;
+};
+
+extern EFI_GUID gMonzaXSchedulerProtocolGuid;
+
+#endif
@@ -0,0 +1,119 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+#ifndef _MONZAX_STATISTICS_H_
+#define _MONZAX_STATISTICS_H_
+
+#define MONZAX_STATISTICS_PROTOCOL_GUID \
+  { 0x092fe2ef, 0x6107, 0x439a, 0x93, 0xbb, 0x5a, 0xd0, 0x9f, 0x25, 0x13, 0xab }
+
+typedef struct _MONZAX_STATISTICS_PROTOCOL MONZAX_STATISTICS_PROTOCOL;
+
+//
+// Histogram bucket 0 counts the values below 1, bucket N the values from
+// 2^(N-1) to 2^N - 1, and the last bucket every value above.
+//
+#define MONZAX_STATISTICS_LATENCY_BUCKETS  20    // in us, the last one is 262 ms and more
+#define MONZAX_STATISTICS_RETRY_BUCKETS    12
+
+//
+// Bus statistics of a MonzaX device, from the transfer status the I2C
+// bridge reports. A NACK of the chip address is the chip refusing the
+// transfer, e.g. while it is busy on the RF side or in a write cycle. A bus
+// that is not free or a lost arbitration is a bus-level problem.
+//
+typedef struct {
+  //
+  // Transfer status responses, by state of the bridge.
+  //
+  UINT32                  StatusIdle;
+  UINT32                  StatusBusy;
+  UINT32                  StatusComplete;
+  UINT32                  StatusError;
+  //
+  // Busy responses with the address of the chip NACKed, the bridge retrying.
+  //
+  UINT32                  BusyAddressNacked;
+  //
+  // Error responses, by cause.
+  //
+  UINT32                  ErrorAddressNacked;     // timed out with the chip address NACKed
+  UINT32                  ErrorBusNotFree;        // timed out waiting for a free bus
+  UINT32                  ErrorArbitrationLost;
+  UINT32                  ErrorReadIncomplete;
+  UINT32                  ErrorWriteIncomplete;
+  //
+  // Retries of the bridge, as reported by completed and failed transfers.
+  //
+  UINT32                  Retries;
+  UINT32                  RetryHistogram[MONZAX_STATISTICS_RETRY_BUCKETS];
+  //
+  // Latency, in us, of every read from the chip and of every write unit,
+  // including the wait for the bridge to finish the previous transfer.
+  //
+  UINT32                  ReadLatencyHistogram[MONZAX_STATISTICS_LATENCY_BUCKETS];
+  UINT32                  WriteLatencyHistogram[MONZAX_STATISTICS_LATENCY_BUCKETS];
+} MONZAX_STATISTICS;
+
+/**
+
+  Get the bus statistics of a MonzaX device.
+
+  @param This        Pointer to the MONZAX_STATISTICS_PROTOCOL instance.
+  @param Statistics  The buffer to hold the statistics.
+
+  @retval EFI_SUCCESS            The statistics are returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_STATISTICS_GET) (
+  IN  MONZAX_STATISTICS_PROTOCOL     *This,
+  OUT MONZAX_STATISTICS              *Statistics
+  );
+
+/**
+
+  Set all the bus statistics of a MonzaX device to 0.
+
+  @param This        Pointer to the MONZAX_STATISTICS_PROTOCOL instance.
+
+  @retval EFI_SUCCESS            The statistics are cleared.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_STATISTICS_RESET) (
+  IN  MONZAX_STATISTICS_PROTOCOL     *This
+  );
+
+struct _MONZAX_STATISTICS_PROTOCOL {
+  MONZAX_STATISTICS_GET              Get;
+  MONZAX_STATISTICS_RESET            Reset;
+};
+
+extern EFI_GUID gMonzaXStatisticsProtocolGuid;
+
+#endif
@@ -0,0 +1,105 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+#ifndef _MONZAX_TRACE_H_
+#define _MONZAX_TRACE_H_
+
+#define MONZAX_TRACE_PROTOCOL_GUID \
+  { 0xcc4aab56, 0x1bb8, 0x496b, 0x81, 0x46, 0x51, 0x85, 0xc5, 0x87, 0x83, 0xd3 }
+
+typedef struct _MONZAX_TRACE_PROTOCOL MONZAX_TRACE_PROTOCOL;
+
+typedef enum {
+  MonzaXTraceI2cRead,       // a read from the chip
+  MonzaXTraceI2cWrite,      // a write to the chip
+  MonzaXTraceReportOut,     // a report sent to the USB bridge
+  MonzaXTraceReportIn,      // a report received from the USB bridge
+  MonzaXTraceMuxSelect      // a channel select of the I2C multiplexer, Address is the channel
+} MONZAX_TRACE_OPCODE;
+
+//
+// One traced transfer.
+//
+typedef struct {
+  //
+  // End of the transfer, in ns of the performance counter. It wraps with
+  // the counter.
+  //
+  UINT64                  Timestamp;
+  EFI_STATUS              Status;
+  UINT32                  Latency;  // in us
+  //
+  // The memory address of an I2C transfer, or the ID of a report.
+  //
+  UINT16                  Address;
+  UINT16                  Length;   // bytes transferred
+  UINT8                   OpCode;   // MONZAX_TRACE_OPCODE
+  UINT8                   Slave;    // 7-bit I2C address, 0 for reports
+} MONZAX_TRACE_ENTRY;
+
+/**
+
+  Get the most recent entries of the trace ring of a MonzaX device.
+
+  @param This        Pointer to the MONZAX_TRACE_PROTOCOL instance.
+  @param EntryCount  On input, the number of entries Entries can hold.
+                     On output, the number of entries returned.
+  @param Entries     The buffer to hold the entries, oldest first.
+
+  @retval EFI_SUCCESS            The entries are returned.
+  @retval EFI_INVALID_PARAMETER  EntryCount is NULL, or Entries is NULL and *EntryCount is not 0.
+  @retval EFI_UNSUPPORTED        Tracing is compiled out of the driver.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_TRACE_GET_ENTRIES) (
+  IN  MONZAX_TRACE_PROTOCOL          *This,
+  IN OUT UINTN                       *EntryCount,
+  OUT MONZAX_TRACE_ENTRY             *Entries
+  );
+
+/**
+
+  Empty the trace ring of a MonzaX device.
+
+  @param This        Pointer to the MONZAX_TRACE_PROTOCOL instance.
+
+  @retval EFI_SUCCESS            The trace ring is empty.
+
+**/
+typedef
+EFI_STATUS
+(EFIAPI *MONZAX_TRACE_CLEAR) (
+  IN  MONZAX_TRACE_PROTOCOL          *This
+  );
+
+struct _MONZAX_TRACE_PROTOCOL {
+  MONZAX_TRACE_GET_ENTRIES           GetEntries;
+  MONZAX_TRACE_CLEAR                 Clear;
+};
+
+extern EFI_GUID gMonzaXTraceProtocolGuid;
+
+#endif
@@ -23,6 +23,7 @@ SOFTWARE.
 **/
 
 #include <Library\MonzaXLib.h>
+#include <Library/BaseMemoryLib.h>
 
 
 UINT8 mMonzaxDeviceIds[] = { 0x68, 0x6A, 0x6C, 0x6E };
@@ -1280,13 +1281,23 @@ MonzaxSetActiveDevice (
   IN UINT8                  I2cDeviceId
   )
 {
+  EFI_STATUS   Status;
   MONZAX_INFO  MonzaxInfo;
 
-  MonzaxInfo.Revision      = MONZAX_INFO_REVISION;
-  MonzaxInfo.Length        = sizeof(MonzaxInfo);
+  //
+  // A revision 4 structure ends before the multiplexer channel, so SetInfo
+  // keeps the channel of the driver. GetInfo is not used to fill in the
+  // rest: it identifies the chip of the device being left first.
+  //
+  ZeroMem (&MonzaxInfo, sizeof(MonzaxInfo));
+  MonzaxInfo.Revision      = MONZAX_INFO_REVISION_4;
+  MonzaxInfo.Length        = MONZAX_INFO_REVISION_4_LENGTH;
   MonzaxInfo.I2cDeviceId   = I2cDeviceId;
   MonzaxInfo.ChipModelType = Model;
-  MonzaXIo->SetInfo (MonzaXIo, &MonzaxInfo);
+  Status = MonzaXIo->SetInfo (MonzaXIo, &MonzaxInfo);
+  if (EFI_ERROR (Status)) {
+    return 1;
+  }
 
   return 0;
 }
@@ -0,0 +1,230 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+#include <Library/MonzaXLib.h>
+#include <Library/DebugLib.h>
+#include <Library/PerformanceLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+#include <Library/UefiLib.h>
+
+//
+// Models tried by MonzaxDetectChipModel. The 2K Dura goes first: its TID
+// read is sent to DeviceId + 1, which an 8K Dura does not answer, while the
+// second address byte of an 8K Dura read would reach a 2K Dura as data.
+//
+MONZAX_CHIP_MODEL_TYPE  mMonzaxChipModels[] = {
+  MonzaX2KDura,
+  MonzaX8KDura
+};
+
+/**
+
+  Identify the chip model from the class ID and model number in its TID.
+
+  The TID is read with the address layout of each model in turn. The layout
+  that returns the Gen2 class ID and its own model number wins.
+
+  @param Read           Reads the chip with the address layout of *ChipModelType.
+  @param Context        The context passed to Read.
+  @param ChipModelType  On input, the model assumed so far. On output, the
+                        model of the chip, or the input value if none answered.
+
+  @retval EFI_SUCCESS       *ChipModelType holds the model of the chip.
+  @retval EFI_NOT_FOUND     No MonzaX chip answered.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaxDetectChipModel (
+  IN MONZAX_PROBE_READ          Read,
+  IN VOID                       *Context,
+  IN OUT MONZAX_CHIP_MODEL_TYPE *ChipModelType
+  )
+{
+  MONZAX_CHIP_MODEL_TYPE  Default;
+  UINT16                  Address;
+  UINT8                   Tid[4];
+  UINT16                  Model;
+  UINTN                   Index;
+
+  Default = *ChipModelType;
+  for (Index = 0; Index < sizeof(mMonzaxChipModels) / sizeof(mMonzaxChipModels[0]); Index++) {
+    *ChipModelType = mMonzaxChipModels[Index];
+    if (*ChipModelType == MonzaX2KDura) {
+      Address = MONZAX_BASE_ADDRESS_TID_2K + MONZAX_TID_OFFSET_2K;
+    } else {
+      Address = MONZAX_BASE_ADDRESS_TID_8K + MONZAX_TID_OFFSET_8K;
+    }
+    if (Read (Context, Address, Tid, sizeof(Tid)) != sizeof(Tid)) {
+      continue;
+    }
+    // Model number is the lower 12 bits of the second TID word.
+    Model = (UINT16)(((Tid[2] << 8) | Tid[3]) & 0x0FFF);
+    if ((Tid[0] == MONZAX_TID_CLASS_ID_GEN2) && (Model == (UINT16) *ChipModelType)) {
+      return EFI_SUCCESS;
+    }
+  }
+
+  *ChipModelType = Default;
+  return EFI_NOT_FOUND;
+}
+
+/**
+
+  Timer notification that identifies the chip model after Start.
+
+  @param Event      The probe timer event.
+  @param Context    Pointer to the MONZAX_PROBE instance.
+
+**/
+VOID
+EFIAPI
+MonzaxProbeNotify (
+  IN EFI_EVENT            Event,
+  IN VOID                 *Context
+  )
+{
+  MONZAX_PROBE         *Probe;
+
+  Probe = (MONZAX_PROBE *) Context;
+  EfiAcquireLock (Probe->Lock);
+  MonzaxProbe (Probe);
+  EfiReleaseLock (Probe->Lock);
+}
+
+/**
+
+  Set up the probe of a MonzaX device and create its timer. The caller
+  starts the timer with MONZAX_PROBE_DELAY once the device is published,
+  and closes Probe->Event when the device goes away.
+
+  @param Probe          The probe.
+  @param Handle         The handle the PERF records of the probe are made
+                        on. It is read when the probe runs, so it may be
+                        filled in after this call.
+  @param Lock           The lock of the transfers to the chip.
+  @param ChipModelType  The chip model of the device.
+  @param Read           Reads the chip with the address layout of *ChipModelType.
+  @param Done           Called once the chip is identified, or not.
+  @param Context        The context passed to Read and Done.
+
+  @retval EFI_SUCCESS   The probe is pending.
+  @return Others        The timer cannot be created.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaxProbeInit (
+  OUT MONZAX_PROBE              *Probe,
+  IN EFI_HANDLE                 *Handle,
+  IN EFI_LOCK                   *Lock,
+  IN MONZAX_CHIP_MODEL_TYPE     *ChipModelType,
+  IN MONZAX_PROBE_READ          Read,
+  IN MONZAX_PROBE_DONE          Done,
+  IN VOID                       *Context
+  )
+{
+  Probe->State         = MonzaXProbePending;
+  Probe->Handle        = Handle;
+  Probe->Lock          = Lock;
+  Probe->ChipModelType = ChipModelType;
+  Probe->Read          = Read;
+  Probe->Done          = Done;
+  Probe->Context       = Context;
+
+  return gBS->CreateEvent (
+                EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                TPL_CALLBACK,
+                MonzaxProbeNotify,
+                Probe,
+                &Probe->Event
+                );
+}
+
+/**
+
+  Identify the chip model if it is not known yet. The caller holds
+  Probe->Lock.
+
+  @param Probe      The probe.
+
+  @retval EFI_SUCCESS       *Probe->ChipModelType holds the model of the chip.
+  @retval EFI_NOT_FOUND     No MonzaX chip answered.
+  @retval EFI_NOT_READY     The chip is being identified by an interrupted caller.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaxProbe (
+  IN MONZAX_PROBE               *Probe
+  )
+{
+  EFI_STATUS   Status;
+
+  //
+  // Once the timer is cancelled the notification cannot run on top of us.
+  //
+  if (Probe->State == MonzaXProbePending) {
+    gBS->SetTimer (Probe->Event, TimerCancel, 0);
+  }
+
+  switch (Probe->State) {
+  case MonzaXProbeDone:
+    return EFI_SUCCESS;
+  case MonzaXProbeFailed:
+    return EFI_NOT_FOUND;
+  case MonzaXProbeRunning:
+    return EFI_NOT_READY;
+  default:
+    break;
+  }
+
+  PERF_START_EX (*Probe->Handle, MONZAX_PERF_TOKEN_PROBE, NULL, 0, 0);
+  Probe->State = MonzaXProbeRunning;
+  Status = MonzaxDetectChipModel (Probe->Read, Probe->Context, Probe->ChipModelType);
+  Probe->Done (Probe->Context, Status);
+  Probe->State = EFI_ERROR (Status) ? MonzaXProbeFailed : MonzaXProbeDone;
+  PERF_END_EX (*Probe->Handle, MONZAX_PERF_TOKEN_PROBE, NULL, 0, 0);
+  return Status;
+}
+
+/**
+
+  Take the chip model as known, without reading the chip. The caller holds
+  Probe->Lock.
+
+  @param Probe      The probe.
+
+**/
+VOID
+EFIAPI
+MonzaxProbeSetDone (
+  IN MONZAX_PROBE               *Probe
+  )
+{
+  if (Probe->State == MonzaXProbePending) {
+    gBS->SetTimer (Probe->Event, TimerCancel, 0);
+  }
+  Probe->State = MonzaXProbeDone;
+}
@@ -0,0 +1,215 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+#include <Library/MonzaXLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/TimerLib.h>
+#include <Library/UefiBootServicesTableLib.h>
+
+#define MONZAX_TRACE_RING_FROM_PROTOCOL(a) \
+    CR(a, MONZAX_TRACE_RING, Protocol, MONZAX_TRACE_RING_SIGNATURE)
+
+/**
+
+  Get the performance counter ticks elapsed since a start value.
+
+  @param Ring       The trace ring, which holds the range of the counter.
+  @param Start      The performance counter at the start.
+  @param End        The performance counter at the end.
+
+  @return The ticks elapsed. The counter is assumed to wrap at most once.
+
+**/
+UINT64
+EFIAPI
+MonzaxGetElapsedTicks (
+  IN MONZAX_TRACE_RING      *Ring,
+  IN UINT64                 Start,
+  IN UINT64                 End
+  )
+{
+  if (Ring->CounterEnd > Ring->CounterStart) {
+    if (End >= Start) {
+      return End - Start;
+    }
+    return (Ring->CounterEnd - Start) + (End - Ring->CounterStart);
+  } else {
+    if (Start >= End) {
+      return Start - End;
+    }
+    return (Start - Ring->CounterEnd) + (Ring->CounterStart - End);
+  }
+}
+
+/**
+
+  Record a transfer into a trace ring. Use MONZAX_TRACE instead, which
+  compiles to nothing in RELEASE builds.
+
+  @param Ring       The trace ring.
+  @param OpCode     The MONZAX_TRACE_OPCODE of the transfer.
+  @param Slave      The 7-bit I2C address, 0 for reports.
+  @param Address    The memory address, or the report ID.
+  @param Length     The number of bytes transferred.
+  @param Status     The status of the transfer.
+  @param Start      The performance counter at the start of the transfer.
+
+**/
+VOID
+EFIAPI
+MonzaxTraceRecord (
+  IN MONZAX_TRACE_RING      *Ring,
+  IN MONZAX_TRACE_OPCODE    OpCode,
+  IN UINT8                  Slave,
+  IN UINT16                 Address,
+  IN UINTN                  Length,
+  IN EFI_STATUS             Status,
+  IN UINT64                 Start
+  )
+{
+  UINT64               End;
+  UINT64               Timestamp;
+  UINT32               Latency;
+  EFI_TPL              OldTpl;
+  MONZAX_TRACE_ENTRY   *Entry;
+
+  End = GetPerformanceCounter ();
+  Timestamp = GetTimeInNanoSecond (MonzaxGetElapsedTicks (Ring, Ring->CounterStart, End));
+  Latency = (UINT32) DivU64x32 (GetTimeInNanoSecond (MonzaxGetElapsedTicks (Ring, Start, End)), 1000);
+
+  //
+  // Asynchronous requests complete in a TPL_CALLBACK notification. The
+  // entry is filled at TPL_NOTIFY too, so that GetEntries never copies a
+  // half written one.
+  //
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Entry = &Ring->Entries[Ring->Count % MONZAX_TRACE_RING_SIZE];
+  Ring->Count++;
+  Entry->Timestamp = Timestamp;
+  Entry->Status    = Status;
+  Entry->Latency   = Latency;
+  Entry->Address   = Address;
+  Entry->Length    = (UINT16) Length;
+  Entry->OpCode    = (UINT8) OpCode;
+  Entry->Slave     = Slave;
+  gBS->RestoreTPL (OldTpl);
+}
+
+/**
+
+  Get the most recent entries of the trace ring of a MonzaX device.
+
+  @param This        Pointer to the MONZAX_TRACE_PROTOCOL instance.
+  @param EntryCount  On input, the number of entries Entries can hold.
+                     On output, the number of entries returned.
+  @param Entries     The buffer to hold the entries, oldest first.
+
+  @retval EFI_SUCCESS            The entries are returned.
+  @retval EFI_INVALID_PARAMETER  EntryCount is NULL, or Entries is NULL and *EntryCount is not 0.
+  @retval EFI_UNSUPPORTED        Tracing is compiled out of the driver.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXTraceGetEntries (
+  IN  MONZAX_TRACE_PROTOCOL          *This,
+  IN OUT UINTN                       *EntryCount,
+  OUT MONZAX_TRACE_ENTRY             *Entries
+  )
+{
+  MONZAX_TRACE_RING    *Ring;
+  EFI_TPL              OldTpl;
+  UINTN                Count;
+  UINTN                Index;
+
+  if ((EntryCount == NULL) || ((Entries == NULL) && (*EntryCount != 0))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  if (!MONZAX_TRACE_ENABLED) {
+    *EntryCount = 0;
+    return EFI_UNSUPPORTED;
+  }
+
+  Ring = MONZAX_TRACE_RING_FROM_PROTOCOL (This);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Count = MIN (Ring->Count, MONZAX_TRACE_RING_SIZE);
+  Count = MIN (Count, *EntryCount);
+  for (Index = Ring->Count - Count; Index < Ring->Count; Index++) {
+    CopyMem (Entries++, &Ring->Entries[Index % MONZAX_TRACE_RING_SIZE], sizeof(MONZAX_TRACE_ENTRY));
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  *EntryCount = Count;
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Empty the trace ring of a MonzaX device.
+
+  @param This        Pointer to the MONZAX_TRACE_PROTOCOL instance.
+
+  @retval EFI_SUCCESS            The trace ring is empty.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXTraceClear (
+  IN  MONZAX_TRACE_PROTOCOL          *This
+  )
+{
+  MONZAX_TRACE_RING    *Ring;
+  EFI_TPL              OldTpl;
+
+  Ring = MONZAX_TRACE_RING_FROM_PROTOCOL (This);
+
+  OldTpl = gBS->RaiseTPL (TPL_NOTIFY);
+  Ring->Count = 0;
+  gBS->RestoreTPL (OldTpl);
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Set up a trace ring and the MONZAX_TRACE_PROTOCOL that reads it.
+
+  @param Ring       The trace ring.
+
+**/
+VOID
+EFIAPI
+MonzaxTraceInit (
+  OUT MONZAX_TRACE_RING     *Ring
+  )
+{
+  Ring->Signature           = MONZAX_TRACE_RING_SIGNATURE;
+  Ring->Protocol.GetEntries = MonzaXTraceGetEntries;
+  Ring->Protocol.Clear      = MonzaXTraceClear;
+  Ring->Count               = 0;
+  GetPerformanceCounterProperties (&Ring->CounterStart, &Ring->CounterEnd);
+}
@@ -48,6 +48,11 @@ GLOBAL_REMOVE_IF_UNREFERENCED EFI_UNICODE_STRING_TABLE mMonzaXDriverNameTable[]
   { NULL , NULL }
 };
 
+GLOBAL_REMOVE_IF_UNREFERENCED EFI_UNICODE_STRING_TABLE mMonzaXControllerNameTable[] = {
+  { "eng;en", L"MonzaX I2C Device" },
+  { NULL , NULL }
+};
+
 /**
   Retrieves a Unicode string that is the user readable name of the driver.
 
@@ -170,49 +175,50 @@ MonzaXComponentNameGetControllerName (
   EFI_STATUS                  Status;
   MONZAX_DEV                  *MonzaXDev;
   MONZAX_IO_PROTOCOL          *MonzaX;
-  EFI_I2C_IO_PROTOCOL         *I2cIoProtocol;
 
   //
-  // This is a device driver, so ChildHandle must be NULL.
+  // Check Controller's handle
   //
-  if (ChildHandle != NULL) {
-    return EFI_UNSUPPORTED;
+  Status = EfiTestManagedDevice (
+             ControllerHandle,
+             gMonzaXDriverBinding.DriverBindingHandle,
+             &gEfiI2cIoProtocolGuid
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
 
   //
-  // Check Controller's handle
+  // Without ChildHandle, name the I2C device the chips sit on.
   //
-  Status = gBS->OpenProtocol (
-                  ControllerHandle,
-                  &gEfiI2cIoProtocolGuid,
-                  (VOID **) &I2cIoProtocol,
-                  gMonzaXDriverBinding.DriverBindingHandle,
-                  ControllerHandle,
-                  EFI_OPEN_PROTOCOL_BY_DRIVER
-                  );
-  if (!EFI_ERROR (Status)) {
-    gBS->CloseProtocol (
-           ControllerHandle,
-           &gEfiI2cIoProtocolGuid,
-           gMonzaXDriverBinding.DriverBindingHandle,
-           ControllerHandle
-           );
-
-    return EFI_UNSUPPORTED;
+  if (ChildHandle == NULL) {
+    return LookupUnicodeString2 (
+             Language,
+             This->SupportedLanguages,
+             mMonzaXControllerNameTable,
+             ControllerName,
+             (BOOLEAN)(This == &gMonzaXComponentName)
+             );
   }
 
-  if (Status != EFI_ALREADY_STARTED) {
-    return EFI_UNSUPPORTED;
+  Status = EfiTestChildHandle (
+             ControllerHandle,
+             ChildHandle,
+             &gEfiI2cIoProtocolGuid
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
   }
+
   //
   // Get the device context
   //
   Status = gBS->OpenProtocol (
-                  ControllerHandle,
+                  ChildHandle,
                   &gMonzaXIoProtocolGuid,
                   (VOID **) &MonzaX,
                   gMonzaXDriverBinding.DriverBindingHandle,
-                  ControllerHandle,
+                  ChildHandle,
                   EFI_OPEN_PROTOCOL_GET_PROTOCOL
                   );
 
@@ -24,141 +24,216 @@ SOFTWARE.
 
 #include "MonzaXDxe.h"
 
-typedef struct {
-  ///
-  /// Number of elements in the operation array
-  ///
-  UINTN OperationCount;
-
-  ///
-  /// Description of the I2C operation
-  ///
-  EFI_I2C_OPERATION Operation[2];
-} I2C_REQUEST_PACKET_WRITE_READ;
-
-
-#define DUMP_ASCII
 
 /**
+  Get I2C slave address index of an I2C device ID.
 
-  This function dump raw data.
-
-  @param  Data  raw data
-  @param  Size  raw data size
+  @param Dev          Pointer to the MONZAX_DEV instance.
+  @param I2cDeviceId  The I2C device ID.
 
+  @return I2C slave address index of I2cDeviceId.
 **/
-VOID
-InternalDumpData (
-  IN UINT8  *Data,
-  IN UINTN  Size
+UINTN
+FindSlaveAddressIndex (
+  IN MONZAX_DEV           *Dev,
+  IN UINT8                I2cDeviceId
   )
 {
   UINTN  Index;
-  for (Index = 0; Index < Size; Index++) {
-    DEBUG ((EFI_D_INFO, "%02x ", (UINTN)Data[Index]));
+
+  for (Index = 0; Index < Dev->I2cDevice->SlaveAddressCount; Index ++) {
+    if ((UINT8)Dev->I2cDevice->SlaveAddressArray[Index] == I2cDeviceId) {
+      return Index;
+    }
   }
+  
+  // Invalid Index
+  return Dev->I2cDevice->SlaveAddressCount;
 }
 
 /**
+  Select the multiplexer channel of the chip.
 
-  Return if char is printable.
+  The select request is only sent when the channel differs from the one
+  selected last on the bus.
 
-  @param Ch A Character
-
-  @retval TRUE  If the char is printable.
-  @retval FALSE If the char is not printable.
+  @param Dev          Pointer to the MONZAX_DEV instance.
+  @param Channel      The multiplexer channel.
 
+  @retval EFI_SUCCESS Channel is selected, or there is no multiplexer.
+  @retval Others      The select request failed.
 **/
-STATIC
-BOOLEAN
-IsPrintable (
-  IN UINT8 Ch
+EFI_STATUS
+SelectMuxChannel (
+  IN MONZAX_DEV           *Dev,
+  IN UINT8                Channel
   )
 {
-  if ((Ch <= 0x20) || (Ch >= 0x7F)) {
-    return FALSE;
-  } else {
-    return TRUE;
+  EFI_STATUS                Status;
+  EFI_I2C_REQUEST_PACKET    Request;
+  UINT8                     Control;
+  UINT64                    TraceStart;
+
+  if ((Dev->Mux == NULL) || (Dev->Mux->Channel == Channel)) {
+    return EFI_SUCCESS;
   }
+
+  Control = (UINT8)(1 << Channel);
+  Request.OperationCount = 1;
+  Request.Operation[0].Flags = 0; // ~I2C_FLAG_READ
+  Request.Operation[0].LengthInBytes = sizeof(Control);
+  Request.Operation[0].Buffer = &Control;
+
+  Dev->QueueRequestCount++;
+  TraceStart = MONZAX_TRACE_BEGIN ();
+  Status = Dev->I2cIo->QueueRequest (
+                             Dev->I2cIo,
+                             Dev->Mux->SlaveAddressIndex,
+                             NULL,
+                             &Request,
+                             NULL
+                             );
+  MONZAX_TRACE (Dev, MonzaXTraceMuxSelect, Dev->Mux->SlaveAddress, Channel, EFI_ERROR (Status) ? 0 : sizeof(Control), Status, TraceStart);
+  if (EFI_ERROR(Status)) {
+    DEBUG ((EFI_D_INFO, "SelectMuxChannel %d - %r\n", Channel, Status));
+    Dev->Mux->Channel = MONZAX_MUX_CHANNEL_NONE;
+    return Status;
+  }
+
+  Dev->Mux->Channel = Channel;
+  return EFI_SUCCESS;
 }
 
 /**
 
-  This function dump raw data with colume format.
+  Read a list of segments from I2C devices.
 
-  @param  Data  raw data
-  @param  Size  raw data size
+  Every segment is a write-read request to its own slave. All requests are
+  queued back-to-back before waiting, so the I2C bus runs them in a row with
+  no other request in between, and the caller waits for one completion.
+  A segment starting at the internal address pointer of the chip is a
+  read-only request when PcdMonzaXSequentialRead is TRUE.
+
+  @param Dev          Pointer to the MONZAX_DEV instance.
+  @param Segments     The segment list.
+  @param SegmentCount The number of segments, up to MONZAX_READ_SEGMENT_MAX.
+
+  @return  The number of bytes read, counted from the first segment.
 
 **/
-VOID
-InternalDumpHex (
-  IN UINT8  *Data,
-  IN UINTN  Size
+UINTN
+I2cReadSegments (
+  IN MONZAX_DEV           *Dev,
+  IN MONZAX_READ_SEGMENT  *Segments,
+  IN UINTN                SegmentCount
   )
 {
-  UINTN   Index;
-  UINTN   Count;
-  UINTN   Left;
-#ifdef DUMP_ASCII
-  UINTN   Index2;
-#endif
-
-#define COLUME_SIZE  (16)
-
-  Count = Size / COLUME_SIZE;
-  Left  = Size % COLUME_SIZE;
-  for (Index = 0; Index < Count; Index++) {
-//    DEBUG ((EFI_D_INFO, "%04x: ", Index * COLUME_SIZE));
-    InternalDumpData (Data + Index * COLUME_SIZE, COLUME_SIZE);
-#ifdef DUMP_ASCII
-    DEBUG ((EFI_D_INFO, "        '"));
-    for ( Index2 = 0; Index2 < COLUME_SIZE; Index2++ ) {
-      DEBUG ((EFI_D_INFO, "%c", IsPrintable((Data + Index * COLUME_SIZE)[Index2]) ? (Data + Index * COLUME_SIZE)[Index2] : '.'));
-    }
-    DEBUG ((EFI_D_INFO, "'"));
-#endif
-    DEBUG ((EFI_D_INFO, "\n"));
+  EFI_STATUS                       Status;
+  EFI_TPL                          OldTpl;
+  I2C_REQUEST_PACKET_WRITE_READ    Request[MONZAX_READ_SEGMENT_MAX];
+  UINT8                            Addr[MONZAX_READ_SEGMENT_MAX][2];
+  EFI_STATUS                       I2cStatus[MONZAX_READ_SEGMENT_MAX];
+  UINTN                            Index;
+  UINTN                            Queued;
+  UINTN                            ReadByte;
+  UINT64                           TraceStart;
+
+  ASSERT ((SegmentCount != 0) && (SegmentCount <= MONZAX_READ_SEGMENT_MAX));
+
+  if (EFI_ERROR (SelectMuxChannel (Dev, Dev->MuxChannel))) {
+    return 0;
   }
 
-  if (Left != 0) {
-//    DEBUG ((EFI_D_INFO, "%04x: ", Index * COLUME_SIZE));
-    InternalDumpData (Data + Index * COLUME_SIZE, Left);
-#ifdef DUMP_ASCII
-    for ( Index2 = 0; Index2 < COLUME_SIZE - Left; Index2++ ) {
-      DEBUG ((EFI_D_INFO, "   "));
+  TraceStart = MONZAX_TRACE_BEGIN ();
+
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+
+  for (Queued = 0; Queued < SegmentCount; Queued++) {
+    if (Segments[Queued].AddressLen == 1) {
+      // 8-bit memory address
+      Addr[Queued][0] = (UINT8) Segments[Queued].Address;
+    } else {
+      // 16-bit memory addresss
+      Addr[Queued][0] = (UINT8) (Segments[Queued].Address >> 8) & 0xFF;
+      Addr[Queued][1] = (UINT8) Segments[Queued].Address & 0xFF;
     }
-    DEBUG ((EFI_D_INFO, "        '"));
-    for ( Index2 = 0; Index2 < Left; Index2++ ) {
-      DEBUG ((EFI_D_INFO, "%c", IsPrintable((Data + Index * COLUME_SIZE)[Index2]) ? (Data + Index * COLUME_SIZE)[Index2] : '.'));
+
+    if (FeaturePcdGet (PcdMonzaXSequentialRead) && Dev->ReadPointerValid &&
+        (Dev->ReadPointerSlave == Segments[Queued].I2cDeviceId) &&
+        (Dev->ReadPointer == Segments[Queued].Address)) {
+      //
+      // Current address read, the chip goes on from where it stopped.
+      //
+      Request[Queued].OperationCount = 1;
+      Request[Queued].Operation[0].Flags = I2C_FLAG_READ;
+      Request[Queued].Operation[0].LengthInBytes = (UINT32)Segments[Queued].DataLen;
+      Request[Queued].Operation[0].Buffer = Segments[Queued].Data;
+    } else {
+      Request[Queued].OperationCount = 2;
+      Request[Queued].Operation[0].Flags = 0; // ~I2C_FLAG_READ
+      Request[Queued].Operation[0].LengthInBytes = (UINT32)Segments[Queued].AddressLen;
+      Request[Queued].Operation[0].Buffer = Addr[Queued];
+      Request[Queued].Operation[1].Flags = I2C_FLAG_READ;
+      Request[Queued].Operation[1].LengthInBytes = (UINT32)Segments[Queued].DataLen;
+      Request[Queued].Operation[1].Buffer = Segments[Queued].Data;
     }
-    DEBUG ((EFI_D_INFO, "'"));
-#endif
-    DEBUG ((EFI_D_INFO, "\n"));
-  }
-}
 
-/**
-  Get I2C slave address index according to MonzaxI2cDeviceId.
+    I2cStatus[Queued] = EFI_NOT_READY;
+    Dev->QueueRequestCount++;
+    Status = Dev->I2cIo->QueueRequest (
+                               Dev->I2cIo,
+                               FindSlaveAddressIndex (Dev, Segments[Queued].I2cDeviceId),
+                               Dev->SegmentEvent[Queued],
+                               (EFI_I2C_REQUEST_PACKET *)&Request[Queued],
+                               &I2cStatus[Queued]
+                               );
+    if (EFI_ERROR(Status)) {
+      DEBUG ((EFI_D_INFO, "I2cRead - %r\n", Status));
+      break;
+    }
 
-  @param Dev        Pointer to the MONZAX_DEV instance.
+    //
+    // Where the next segment may continue, if this one completes.
+    //
+    Dev->ReadPointerValid = TRUE;
+    Dev->ReadPointerSlave = Segments[Queued].I2cDeviceId;
+    Dev->ReadPointer      = (UINT16)(Segments[Queued].Address + Segments[Queued].DataLen);
+  }
 
-  @return I2C slave address index according to MonzaxI2cDeviceId.
-**/
-UINTN
-GetSlaveAddressIndex (
-  IN MONZAX_DEV           *Dev
-  )
-{
-  UINTN  Index;
+  gBS->RestoreTPL (OldTpl);
+
+  //
+  // The bus completes the requests in order. The buffers of the queued ones
+  // are on this stack, so wait for all of them even if one failed to queue.
+  //
+  for (Index = 0; Index < Queued; Index++) {
+    do {
+      Status = gBS->CheckEvent (Dev->SegmentEvent[Index]);
+    } while (Status == EFI_NOT_READY);
+    MONZAX_TRACE (
+      Dev,
+      MonzaXTraceI2cRead,
+      Segments[Index].I2cDeviceId,
+      Segments[Index].Address,
+      EFI_ERROR (I2cStatus[Index]) ? 0 : Segments[Index].DataLen,
+      I2cStatus[Index],
+      TraceStart
+      );
+  }
 
-  for (Index = 0; Index < Dev->I2cDevice->SlaveAddressCount; Index ++) {
-    if ((UINT8)Dev->I2cDevice->SlaveAddressArray[Index] == Dev->MonzaxI2cDeviceId) {
-      return Index;
+  ReadByte = 0;
+  for (Index = 0; Index < Queued; Index++) {
+    if (EFI_ERROR (I2cStatus[Index])) {
+      DEBUG ((EFI_D_INFO, "I2cRead - Segment %d - %r\n", Index, I2cStatus[Index]));
+      break;
     }
+    ReadByte += Segments[Index].DataLen;
   }
-  
-  // Invalid Index
-  return Dev->I2cDevice->SlaveAddressCount;
+  if ((Index < SegmentCount) || (Queued < SegmentCount)) {
+    Dev->ReadPointerValid = FALSE;
+  }
+
+  return ReadByte;
 }
 
 /**
@@ -166,6 +241,7 @@ GetSlaveAddressIndex (
   Read from an I2C device.
   
   @param Dev        Pointer to the MONZAX_DEV instance.
+  @param I2cDeviceId The I2C slave address to read from.
   @param Address    The memory address to start reading from.
   @param AddressLen The length of the address in bytes (1 or 2).
   @param Data       A buffer of bytes to hold the data.
@@ -177,56 +253,31 @@ GetSlaveAddressIndex (
 UINTN
 I2cRead (
   IN MONZAX_DEV           *Dev,
+  IN UINT8                I2cDeviceId,
   IN UINT16               Address,
   IN UINT8                AddressLen,
   OUT UINT8               *Data,
   IN UINTN                DataLen
   )
 {
-  EFI_STATUS                       Status;
-  I2C_REQUEST_PACKET_WRITE_READ    Request;
-  UINT8                            Addr[2];
-
-  DEBUG ((EFI_D_INFO, "I2cRead - Addr (0x%x), Size (0x%x)\n", Address, DataLen));
-
-  if (AddressLen == 1) {
-    // 8-bit memory address
-    Addr[0] = (UINT8) Address;
-  } else {
-    // 16-bit memory addresss
-    Addr[0] = (UINT8) (Address >> 8) & 0xFF;
-    Addr[1] = (UINT8) Address & 0xFF;
-  }
-
-  Request.OperationCount = 2;
-  Request.Operation[0].Flags = 0; // ~I2C_FLAG_READ
-  Request.Operation[0].LengthInBytes = (UINT32)AddressLen;
-  Request.Operation[0].Buffer = Addr;
-  Request.Operation[1].Flags = I2C_FLAG_READ;
-  Request.Operation[1].LengthInBytes = (UINT32)DataLen;
-  Request.Operation[1].Buffer = Data;
-
-  Status = Dev->I2cIo->QueueRequest (
-                             Dev->I2cIo,
-                             GetSlaveAddressIndex (Dev),
-                             NULL,
-                             (EFI_I2C_REQUEST_PACKET *)&Request,
-                             NULL
-                             );
-
-  if (EFI_ERROR(Status)) {
-    DEBUG ((EFI_D_INFO, "I2cRead - %r\n", Status));
-    return 0;
-  }
-
-  return DataLen;
+  MONZAX_READ_SEGMENT  Segment;
+
+  Segment.I2cDeviceId = I2cDeviceId;
+  Segment.Address     = Address;
+  Segment.AddressLen  = AddressLen;
+  Segment.Data        = Data;
+  Segment.DataLen     = DataLen;
+  return I2cReadSegments (Dev, &Segment, 1);
 }
 
 /**
 
-  Write to an I2C device. 
+  Write a unit to an I2C device with a single bus transaction.
+
+  The unit must not cross a MONZAX_SIZE_BYTES_WRITE_PAGE boundary.
 
   @param Dev        Pointer to the MONZAX_DEV instance.
+  @param I2cDeviceId The I2C slave address to write to.
   @param Address    The memory address to start writing to.
   @param AddressLen The length of the address in bytes (1 or 2).
   @param Data       The words to write.
@@ -236,8 +287,9 @@ I2cRead (
 
 **/
 UINTN
-I2cWrite (
+I2cWriteUnit (
   IN MONZAX_DEV           *Dev,
+  IN UINT8                I2cDeviceId,
   IN UINT16               Address,
   IN UINT8                AddressLen,
   IN UINT16               *Data,
@@ -246,16 +298,25 @@ I2cWrite (
 {
   EFI_STATUS                Status;
   EFI_I2C_REQUEST_PACKET    Request;
-  UINTN                     Index;
   UINTN                     NewDataLen;
-  UINT8                     *OldBuf;
   UINT8                     *NewBuf;
+  UINT64                    TraceStart;
 
-  DEBUG ((EFI_D_INFO, "I2cWrite - Addr (0x%x), Size (0x%x)\n", Address, DataLen));
+  ASSERT ((Address % MONZAX_SIZE_BYTES_WRITE_PAGE) + DataLen * sizeof(UINT16) <= MONZAX_SIZE_BYTES_WRITE_PAGE);
 
-  OldBuf = (UINT8 *)Data;
+  Dev->ReadPointerValid = FALSE;
+
+  if (EFI_ERROR (SelectMuxChannel (Dev, Dev->MuxChannel))) {
+    return 0;
+  }
+
+  //
+  // The address bytes must directly precede the data in one write operation.
+  // A second operation would put a repeated START between them.
+  //
   NewDataLen = (DataLen * 2) + AddressLen;
-  NewBuf = (UINT8 *)AllocatePool(NewDataLen);
+  NewBuf = Dev->WriteBuffer;
+  ASSERT (NewDataLen <= sizeof(Dev->WriteBuffer));
 
   if (AddressLen == 1) {
     // 8-bit memory address
@@ -266,24 +327,24 @@ I2cWrite (
     NewBuf[1] = (UINT8) Address & 0xFF;
   }
 
-  // Copy the data into the new buffer
-  for (Index = 0; Index < NewDataLen - AddressLen; Index++) {
-    NewBuf[Index + AddressLen] = OldBuf[Index];
-  }
+  // Copy the data into the transfer buffer
+  CopyMem (NewBuf + AddressLen, Data, DataLen * 2);
 
   Request.OperationCount = 1;
   Request.Operation[0].Flags = 0; // ~I2C_FLAG_READ
   Request.Operation[0].LengthInBytes = (UINT32)NewDataLen;
   Request.Operation[0].Buffer = NewBuf;
 
+  Dev->QueueRequestCount++;
+  TraceStart = MONZAX_TRACE_BEGIN ();
   Status = Dev->I2cIo->QueueRequest (
                              Dev->I2cIo,
-                             GetSlaveAddressIndex (Dev),
+                             FindSlaveAddressIndex (Dev, I2cDeviceId),
                              NULL,
                              &Request,
                              NULL
                              );
-  FreePool (NewBuf);
+  MONZAX_TRACE (Dev, MonzaXTraceI2cWrite, I2cDeviceId, Address, EFI_ERROR (Status) ? 0 : DataLen * 2, Status, TraceStart);
   if (EFI_ERROR(Status)) {
     DEBUG ((EFI_D_INFO, "I2cWrite - %r\n", Status));
     return 0;
@@ -292,6 +353,65 @@ I2cWrite (
   return DataLen;
 }
 
+/**
+
+  Write to an I2C device.
+
+  The words are written one write page per bus transaction, so the chip
+  commits each page with a single EEPROM write cycle.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param I2cDeviceId The I2C slave address to write to.
+  @param Address    The memory address to start writing to.
+  @param AddressLen The length of the address in bytes (1 or 2).
+  @param Data       The words to write.
+  @param DataLen    The number of words to write.
+
+  @return The number of words written.
+
+**/
+UINTN
+I2cWrite (
+  IN MONZAX_DEV           *Dev,
+  IN UINT8                I2cDeviceId,
+  IN UINT16               Address,
+  IN UINT8                AddressLen,
+  IN UINT16               *Data,
+  IN UINTN                DataLen
+  )
+{
+  UINTN       WriteWord;
+  UINTN       UnitLen;
+  UINTN       DataWriteLen;
+
+  WriteWord = 0;
+  while (WriteWord < DataLen) {
+    //
+    // Stop at the end of the current write page.
+    //
+    UnitLen = (MONZAX_SIZE_BYTES_WRITE_PAGE - ((Address + WriteWord * sizeof(UINT16)) % MONZAX_SIZE_BYTES_WRITE_PAGE)) / sizeof(UINT16);
+    if (UnitLen > DataLen - WriteWord) {
+      UnitLen = DataLen - WriteWord;
+    }
+
+    DataWriteLen = I2cWriteUnit (
+                     Dev,
+                     I2cDeviceId,
+                     (UINT16)(Address + WriteWord * sizeof(UINT16)),
+                     AddressLen,
+                     Data + WriteWord,
+                     UnitLen
+                     );
+    WriteWord += DataWriteLen;
+    if (DataWriteLen != UnitLen) {
+      DEBUG ((EFI_D_ERROR, "I2cWrite - partial write\n"));
+      return WriteWord;
+    }
+  }
+
+  return WriteWord;
+}
+
 /**
 
   Write data to adjusted address.
@@ -315,40 +435,43 @@ WriteAdjustedAddress (
   UINTN      Count;
   UINTN      Len;
   UINT8      AddressLen;
+  UINT8      I2cDeviceId;
+
+  //
+  // Each transfer carries its own slave address. Dev->MonzaxI2cDeviceId is
+  // never stepped to the upper half, so an interrupting caller cannot see it
+  // off by one.
+  //
+  I2cDeviceId = Dev->MonzaxI2cDeviceId;
 
   // Handle dual address requirement of Monza X 2K Dura
   if (Dev->ChipModelType == MonzaX2KDura) {
     AddressLen = 1;
 
     // Is the supplied address larger than a byte?
-    // If so, change the device id and adjust the address.
+    // If so, use the next device id and adjust the address.
     // The lower bit of the device id is the upper bit of the address.
     if (Address > 0xFF) {
-      Dev->MonzaxI2cDeviceId ++;
-      Address -= 0x0100;
-      Count = I2cWrite (Dev, Address, AddressLen, Data, DataLen);
-      Dev->MonzaxI2cDeviceId --;
+      Count = I2cWrite (Dev, (UINT8)(I2cDeviceId + 1), (UINT16)(Address - 0x0100), AddressLen, Data, DataLen);
     }
     // Will the write operation cross the address boundary (0xFF)?
     // If  so, write the data in two chunks. This prevents addressing
     // problems if the end user has implemented i2c_write using a
     // single word write.
-    else if (Address + (DataLen - 1) > 0xFF) {
-      Len = 0xFF - Address + 1;
-      Count = I2cWrite (Dev, Address, AddressLen, Data, Len);
-      Dev->MonzaxI2cDeviceId ++;
-      Count += I2cWrite (Dev, (UINT16)(Address + Len), AddressLen, Data + Len, DataLen - Len);
-      Dev->MonzaxI2cDeviceId --;
+    else if (Address + (DataLen * sizeof(UINT16) - 1) > 0xFF) {
+      Len = (0xFF - Address + 1) / sizeof(UINT16);
+      Count = I2cWrite (Dev, I2cDeviceId, Address, AddressLen, Data, Len);
+      Count += I2cWrite (Dev, (UINT8)(I2cDeviceId + 1), 0, AddressLen, Data + Len, DataLen - Len);
     }
     // Regular write operation.
     else {
-      Count = I2cWrite(Dev, Address, AddressLen, Data, DataLen);
+      Count = I2cWrite (Dev, I2cDeviceId, Address, AddressLen, Data, DataLen);
     }
   }
   // Monza X 8K Dura. Regular write operation.
   else {
     AddressLen = 2;
-    Count = I2cWrite (Dev, Address, AddressLen, Data, DataLen);
+    Count = I2cWrite (Dev, I2cDeviceId, Address, AddressLen, Data, DataLen);
   }
   return Count;
 }
@@ -376,46 +499,278 @@ ReadAdjustedAddress (
   UINTN      Count;
   UINT8      AddressLen;
   UINTN      Len;
+  MONZAX_READ_SEGMENT  Segments[MONZAX_READ_SEGMENT_MAX];
+  UINT8      I2cDeviceId;
+
+  I2cDeviceId = Dev->MonzaxI2cDeviceId;
 
   // Handle dual address requirement of Monza X 2K Dura
   if (Dev->ChipModelType == MonzaX2KDura) {
     AddressLen = 1;
 
     // Is the supplied address larger than a byte?
-    // If so, change the device id and adjust the address.
+    // If so, use the next device id and adjust the address.
     // The lower bit of the device id is the upper bit of the address.
     if (Address > 0xFF) {
-      Dev->MonzaxI2cDeviceId ++;
-      Address -= 0x0100;
-      Count = I2cRead (Dev, Address, AddressLen, Data, DataLen);
-      Dev->MonzaxI2cDeviceId --;
+      Segments[0].I2cDeviceId = (UINT8)(I2cDeviceId + 1);
+      Segments[0].Address     = (UINT16)(Address - 0x0100);
+      Segments[0].AddressLen  = AddressLen;
+      Segments[0].Data        = Data;
+      Segments[0].DataLen     = DataLen;
+      Count = I2cReadSegments (Dev, Segments, 1);
     }
     // Will the read operation cross the address boundary (0xFF)?
     // If  so, read the data in two chunks. This prevents addressing
     // problems if the end user has implemented i2c_read using a
     // single byte read.
+    // Both chunks are queued together, each to its own device ID.
     else if (Address + (DataLen - 1) > 0xFF) {
       Len = 0xFF - Address + 1;
-      Count = I2cRead (Dev, Address, AddressLen, Data, Len);
-
-      Dev->MonzaxI2cDeviceId ++;
-      Count += I2cRead (Dev, (UINT16)(Address + Len), AddressLen, Data + Len, DataLen - Len);
-      Dev->MonzaxI2cDeviceId --;
+      Segments[0].I2cDeviceId = I2cDeviceId;
+      Segments[0].Address     = Address;
+      Segments[0].AddressLen  = AddressLen;
+      Segments[0].Data        = Data;
+      Segments[0].DataLen     = Len;
+      Segments[1].I2cDeviceId = (UINT8)(I2cDeviceId + 1);
+      Segments[1].Address     = 0;
+      Segments[1].AddressLen  = AddressLen;
+      Segments[1].Data        = Data + Len;
+      Segments[1].DataLen     = DataLen - Len;
+      Count = I2cReadSegments (Dev, Segments, 2);
     }
     // Regular read operation.
     else {
-      Count = I2cRead (Dev, Address, AddressLen, Data, DataLen);
+      Count = I2cRead (Dev, I2cDeviceId, Address, AddressLen, Data, DataLen);
     }
   }
   // Monza X 8K Dura. Regular read operation.
   else {
     AddressLen = 2;
-    Count = I2cRead (Dev, Address, AddressLen, Data, DataLen);
+    Count = I2cRead (Dev, I2cDeviceId, Address, AddressLen, Data, DataLen);
   }
 
   return Count;
 }
 
+/**
+
+  Get the size of the memory of the chip model in use.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @return The size, in bytes, of the address space.
+
+**/
+UINTN
+GetMemorySize (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  if (Dev->ChipModelType == MonzaX8KDura) {
+    return MONZAX_SIZE_BYTES_MEMORY_8K;
+  }
+  return MONZAX_SIZE_BYTES_MEMORY_2K;
+}
+
+/**
+
+  Get the valid bits of the cache blocks holding a range of the memory.
+
+  @param Address    The device address of the first byte.
+  @param DataLen    The number of bytes, not 0.
+
+  @return The valid bits of the blocks.
+
+**/
+UINT32
+GetCacheBlockMask (
+  IN UINTN                Address,
+  IN UINTN                DataLen
+  )
+{
+  UINTN      First;
+  UINTN      Last;
+
+  First = Address / MONZAX_CACHE_BLOCK_SIZE;
+  Last = (Address + DataLen - 1) / MONZAX_CACHE_BLOCK_SIZE;
+  ASSERT (Last < MONZAX_CACHE_BLOCK_COUNT);
+  return (UINT32)((2U << Last) - (1U << First));
+}
+
+/**
+
+  Read the cache blocks holding a range of the memory that are not valid yet.
+
+  Adjacent missing blocks are read with one transfer.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of the first byte.
+  @param DataLen    The number of bytes, not 0. The range must be within the memory.
+
+  @retval TRUE      All the blocks holding the range are valid.
+  @retval FALSE     The chip could not be read, or the cache was invalidated meanwhile.
+
+**/
+BOOLEAN
+FillCache (
+  IN MONZAX_DEV           *Dev,
+  IN UINTN                Address,
+  IN UINTN                DataLen
+  )
+{
+  UINT32     Generation;
+  UINTN      Block;
+  UINTN      Last;
+  UINTN      Start;
+  UINTN      Offset;
+  UINTN      Length;
+
+  Generation = Dev->CacheGeneration;
+  Block = Address / MONZAX_CACHE_BLOCK_SIZE;
+  Last = (Address + DataLen - 1) / MONZAX_CACHE_BLOCK_SIZE;
+  while (Block <= Last) {
+    if ((Dev->CacheValid & (1U << Block)) != 0) {
+      Block++;
+      continue;
+    }
+    Start = Block;
+    while ((Block <= Last) && ((Dev->CacheValid & (1U << Block)) == 0)) {
+      Block++;
+    }
+    // The last block of a 2K Dura is only partly backed by memory.
+    Offset = Start * MONZAX_CACHE_BLOCK_SIZE;
+    Length = MIN (Block * MONZAX_CACHE_BLOCK_SIZE, GetMemorySize (Dev)) - Offset;
+    if (ReadAdjustedAddress (Dev, (UINT16) Offset, Dev->Cache + Offset, Length) != Length) {
+      return FALSE;
+    }
+    if (Dev->CacheGeneration != Generation) {
+      return FALSE;
+    }
+    Dev->CacheValid |= GetCacheBlockMask (Offset, Length);
+  }
+  return TRUE;
+}
+
+/**
+
+  Copy written data into the cache.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address the data is written to.
+  @param Data       A pointer to the data written.
+  @param DataLen    The size, in bytes, of the data.
+  @param Complete   TRUE if all the data reached the chip.
+
+**/
+VOID
+UpdateCache (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  IN UINT8                *Data,
+  IN UINTN                DataLen,
+  IN BOOLEAN              Complete
+  )
+{
+  if ((DataLen == 0) || (Address >= MONZAX_SIZE_BYTES_MEMORY_8K)) {
+    return;
+  }
+  DataLen = MIN (DataLen, MONZAX_SIZE_BYTES_MEMORY_8K - Address);
+  if (Complete) {
+    CopyMem (Dev->Cache + Address, Data, DataLen);
+  } else {
+    // The chip contents are unknown after a partial write.
+    MonzaxInvalidateCache (Dev, Address, DataLen);
+  }
+}
+
+/**
+
+  Drop a range of the memory from the cache.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of the first byte.
+  @param DataLen    The number of bytes. 0 drops the whole cache.
+
+**/
+VOID
+MonzaxInvalidateCache (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  IN UINTN                DataLen
+  )
+{
+  if (DataLen == 0) {
+    Dev->CacheValid = 0;
+  } else if (Address < MONZAX_SIZE_BYTES_MEMORY_8K) {
+    DataLen = MIN (DataLen, MONZAX_SIZE_BYTES_MEMORY_8K - Address);
+    Dev->CacheValid &= ~GetCacheBlockMask (Address, DataLen);
+  }
+  Dev->CacheGeneration++;
+}
+
+/**
+
+  Fill the cache with the whole memory of the chip.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+MonzaxWarmUpCache (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  if (!FeaturePcdGet (PcdMonzaXMemoryCache)) {
+    return;
+  }
+  if (!FillCache (Dev, 0, GetMemorySize (Dev))) {
+    DEBUG ((EFI_D_ERROR, "MonzaxWarmUpCache - fail, reads fill the cache on demand\n"));
+  }
+}
+
+/**
+
+  Read data from MonzaX chip.
+
+  When the cache is enabled, the read is served from the cache and the blocks
+  holding the data are read from the chip first if they are not cached yet.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+
+  @return  The amount of data actually transferred.
+
+**/
+UINTN
+MonzaxReadAddress (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  OUT UINT8               *Data,
+  IN UINTN                DataLen
+  )
+{
+  UINT32     Mask;
+
+  if (!FeaturePcdGet (PcdMonzaXMemoryCache) ||
+      (DataLen == 0) || ((UINTN) Address + DataLen > GetMemorySize (Dev))) {
+    return ReadAdjustedAddress (Dev, Address, Data, DataLen);
+  }
+
+  Mask = GetCacheBlockMask (Address, DataLen);
+  if ((Dev->CacheValid & Mask) == Mask) {
+    Dev->CacheHits++;
+  } else {
+    Dev->CacheMisses++;
+    if (!FillCache (Dev, Address, DataLen)) {
+      return ReadAdjustedAddress (Dev, Address, Data, DataLen);
+    }
+  }
+  CopyMem (Data, Dev->Cache + Address, DataLen);
+  return DataLen;
+}
+
 /**
 
   Write data to MonzaX chip.
@@ -438,8 +793,12 @@ MonzaxWriteAddress (
 {
   UINTN      Count;
   UINT8      *Ptr;
+  UINT16     StartAddress;
+  UINTN      StartLen;
 
   Count = 0;
+  StartAddress = Address;
+  StartLen = DataLen;
 
   // Copy the data pointer.
   Ptr = Data;
@@ -449,7 +808,7 @@ MonzaxWriteAddress (
     UINT8 FirstWord[2];
     // Write does not start on a word boundary.
     // Read the previous byte.
-    ReadAdjustedAddress (Dev, Address - 1, FirstWord, 1);
+    MonzaxReadAddress (Dev, Address - 1, FirstWord, 1);
     // Append the previous byte with the first byte of data.
     // This is the first word. Write it to memory.
     FirstWord[1] = *Ptr;
@@ -460,13 +819,13 @@ MonzaxWriteAddress (
     DataLen--;
   }
 
-  // Write one word at a time.
-  while (DataLen > 1) {
-    Count += WriteAdjustedAddress (Dev, Address, (UINT16*) Ptr, 1);
+  // Write all whole words at once. I2cWrite splits them per write page.
+  if (DataLen > 1) {
+    Count += WriteAdjustedAddress (Dev, Address, (UINT16*) Ptr, DataLen / 2);
     // Adjust the address, data pointer and length.
-    Address += 2;
-    DataLen -= 2;
-    Ptr += 2;
+    Address = (UINT16)(Address + (DataLen & ~(UINTN)1));
+    Ptr += DataLen & ~(UINTN)1;
+    DataLen &= 1;
   }
 
   // Handle partial word.
@@ -475,36 +834,69 @@ MonzaxWriteAddress (
     // Write does not end on a word boundary.
     // Read the next byte.
     LastWord[0] = *Ptr;
-    ReadAdjustedAddress (Dev, Address + 1, LastWord + 1, 1);
+    MonzaxReadAddress (Dev, Address + 1, LastWord + 1, 1);
     // This is the last word. Write it.
     Count += WriteAdjustedAddress (Dev, Address, (UINT16 *) LastWord, 1);
   }
 
+  if (FeaturePcdGet (PcdMonzaXMemoryCache)) {
+    UpdateCache (Dev, StartAddress, Data, StartLen, (BOOLEAN)(Count * 2 >= (StartAddress & 1) + StartLen));
+  }
+
   // Count is in words. Return bytes.
   return Count * 2;
 }
 
 /**
 
-  Read data from MonzaX chip.
+  Read the TID of the chip for the probe, with the address layout of
+  Dev->ChipModelType.
 
-  @param Dev        Pointer to the MONZAX_DEV instance.
-  @param Address    The device address of MonzaX chip on where the data is read from.
-  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
-  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+  @param Context    Pointer to the MONZAX_DEV instance.
+  @param Address    The memory address to start reading from.
+  @param Data       A buffer of bytes to hold the data.
+  @param DataLen    The number of bytes to read.
 
-  @return  The amount of data actually transferred.
+  @return  The number of bytes read.
 
 **/
 UINTN
-MonzaxReadAddress (
-  IN MONZAX_DEV           *Dev,
-  IN UINT16               Address,
+EFIAPI
+MonzaxProbeRead (
+  IN  VOID                *Context,
+  IN  UINT16              Address,
   OUT UINT8               *Data,
-  IN UINTN                DataLen
+  IN  UINTN               DataLen
+  )
+{
+  return ReadAdjustedAddress ((MONZAX_DEV *) Context, Address, Data, DataLen);
+}
+
+/**
+
+  Start over the memory cache once the chip model is identified.
+
+  @param Context    Pointer to the MONZAX_DEV instance.
+  @param Status     EFI_SUCCESS if the chip model is identified.
+
+**/
+VOID
+EFIAPI
+MonzaxProbeComplete (
+  IN  VOID                *Context,
+  IN  EFI_STATUS          Status
   )
 {
-  return ReadAdjustedAddress (Dev, Address, Data, DataLen);
+  MONZAX_DEV           *Dev;
+
+  Dev = (MONZAX_DEV *) Context;
+  DEBUG ((EFI_D_INFO, "MonzaxProbe - 0x%02x: %r, model 0x%x\n", Dev->MonzaxI2cDeviceId, Status, Dev->ChipModelType));
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  MonzaxInvalidateCache (Dev, 0, 0);
+  MonzaxWarmUpCache (Dev);
 }
 
 /**
@@ -517,6 +909,8 @@ MonzaxReadAddress (
   @retval EFI_SUCCESS            The MonzaX information structure is returned.
   @retval EFI_INVALID_PARAMETER  Info is NULL.
   @retval EFI_BUFFER_TOO_SMALL   The Info buffer is too small to hold the full data.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+  @retval EFI_NOT_READY          The chip model is being identified by an interrupted caller.
 
 **/
 EFI_STATUS
@@ -526,6 +920,7 @@ MonzaXIoGetInfo (
   IN OUT MONZAX_INFO                 *Info
   )
 {
+  EFI_STATUS           Status;
   MONZAX_DEV           *Dev;
 
   Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (This);
@@ -534,14 +929,56 @@ MonzaXIoGetInfo (
     return EFI_INVALID_PARAMETER;
   }
 
-  if (Info->Length < sizeof(MONZAX_INFO)) {
+  if (Info->Length < MONZAX_INFO_REVISION_1_LENGTH) {
     Info->Length = sizeof(MONZAX_INFO);
     return EFI_BUFFER_TOO_SMALL;
   }
-  Info->Revision = MONZAX_INFO_REVISION;
-  Info->Length = sizeof(MONZAX_INFO);
+  EfiAcquireLock (&Dev->TransferLock);
+  // Report the detected model rather than the default one.
+  Status = MonzaxProbe (&Dev->Probe);
   Info->I2cDeviceId = Dev->MonzaxI2cDeviceId;
   Info->ChipModelType = Dev->ChipModelType;
+  EfiReleaseLock (&Dev->TransferLock);
+  if (EFI_ERROR (Status)) {
+    return (Status == EFI_NOT_READY) ? EFI_NOT_READY : EFI_DEVICE_ERROR;
+  }
+  if (Info->Length < MONZAX_INFO_REVISION_2_LENGTH) {
+    Info->Revision = MONZAX_INFO_REVISION_1;
+    Info->Length = MONZAX_INFO_REVISION_1_LENGTH;
+    return EFI_SUCCESS;
+  }
+  //
+  // The bus is owned by the I2C host controller driver, and the I2C master
+  // cannot be asked for its frequency. Only the frequency set at start is
+  // known, and only while no platform bus configuration may change it.
+  //
+  Info->BusFrequency = Dev->BusFrequency;
+  Info->WriteTimeout = 0;
+  Info->ReadTimeout = 0;
+  Info->RetryLimit = 0;
+  Info->SclLowTimeout = FALSE;
+  if (Info->Length < MONZAX_INFO_REVISION_3_LENGTH) {
+    Info->Revision = MONZAX_INFO_REVISION_2;
+    Info->Length = MONZAX_INFO_REVISION_2_LENGTH;
+    return EFI_SUCCESS;
+  }
+  Info->CacheHits = Dev->CacheHits;
+  Info->CacheMisses = Dev->CacheMisses;
+  if (Info->Length < MONZAX_INFO_REVISION_4_LENGTH) {
+    Info->Revision = MONZAX_INFO_REVISION_3;
+    Info->Length = MONZAX_INFO_REVISION_3_LENGTH;
+    return EFI_SUCCESS;
+  }
+  Info->IoCalls = Dev->IoCallCount;
+  Info->BusTransfers = (UINT32) Dev->QueueRequestCount;
+  if (Info->Length < sizeof(MONZAX_INFO)) {
+    Info->Revision = MONZAX_INFO_REVISION_4;
+    Info->Length = MONZAX_INFO_REVISION_4_LENGTH;
+    return EFI_SUCCESS;
+  }
+  Info->Revision = MONZAX_INFO_REVISION;
+  Info->Length = sizeof(MONZAX_INFO);
+  Info->MuxChannel = Dev->MuxChannel;
 
   return EFI_SUCCESS;
 }
@@ -555,6 +992,7 @@ MonzaXIoGetInfo (
 
   @retval EFI_SUCCESS            The MonzaX information is set.
   @retval EFI_INVALID_PARAMETER  Info is NULL.
+  @retval EFI_INVALID_PARAMETER  Info->MuxChannel is not a channel of the multiplexer.
 
 **/
 EFI_STATUS
@@ -565,6 +1003,7 @@ MonzaXIoSetInfo (
   )
 {
   MONZAX_DEV           *Dev;
+  UINT8                MuxChannel;
 
   Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL(This);
 
@@ -572,11 +1011,32 @@ MonzaXIoSetInfo (
     return EFI_INVALID_PARAMETER;
   }
 
-  if (Info->Length < sizeof(MONZAX_INFO)) {
+  if (Info->Length < MONZAX_INFO_REVISION_1_LENGTH) {
     return EFI_BUFFER_TOO_SMALL;
   }
+  MuxChannel = Dev->MuxChannel;
+  if ((Info->Length >= sizeof(MONZAX_INFO)) && (Dev->Mux != NULL)) {
+    if (Info->MuxChannel >= MONZAX_MUX_CHANNEL_MAX) {
+      return EFI_INVALID_PARAMETER;
+    }
+    MuxChannel = Info->MuxChannel;
+  }
+
+  EfiAcquireLock (&Dev->TransferLock);
+  if ((Dev->MonzaxI2cDeviceId != Info->I2cDeviceId) || (Dev->ChipModelType != Info->ChipModelType) ||
+      (Dev->MuxChannel != MuxChannel)) {
+    MonzaxInvalidateCache (Dev, 0, 0);
+  }
   Dev->MonzaxI2cDeviceId = Info->I2cDeviceId;
   Dev->ChipModelType = Info->ChipModelType;
+  Dev->MuxChannel = MuxChannel;
+  Dev->ReadPointerValid = FALSE;
+
+  //
+  // The caller names the model, so there is nothing left to identify.
+  //
+  MonzaxProbeSetDone (&Dev->Probe);
+  EfiReleaseLock (&Dev->TransferLock);
 
   return EFI_SUCCESS;
 }
@@ -596,6 +1056,7 @@ MonzaXIoSetInfo (
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Read data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 EFI_STATUS
@@ -610,11 +1071,25 @@ MonzaXIoRead (
   MONZAX_DEV           *Dev;
   UINTN                TransferDataLen;
   UINTN                ExpectDataLen;
+  UINTN                TransferCount;
 
   Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (This);
+  PERF_START_EX (Dev->Handle, MONZAX_PERF_TOKEN_READ, NULL, 0, 0);
+  EfiAcquireLock (&Dev->TransferLock);
+  Dev->IoCallCount++;
+  if (EFI_ERROR (MonzaxProbe (&Dev->Probe))) {
+    EfiReleaseLock (&Dev->TransferLock);
+    PERF_END_EX (Dev->Handle, MONZAX_PERF_TOKEN_READ, NULL, 0, 0);
+    *DataLen = 0;
+    return EFI_DEVICE_ERROR;
+  }
   ExpectDataLen = *DataLen;
+  TransferCount = Dev->QueueRequestCount;
   TransferDataLen = MonzaxReadAddress (Dev, Address, Data, *DataLen);
+  EfiReleaseLock (&Dev->TransferLock);
+  PERF_END_EX (Dev->Handle, MONZAX_PERF_TOKEN_READ, NULL, 0, 0);
   *DataLen = TransferDataLen;
+  DEBUG ((EFI_D_INFO, "MonzaXIoRead - 0x%x bytes, 0x%x I2C requests\n", TransferDataLen, Dev->QueueRequestCount - TransferCount));
   if (TransferDataLen == 0) {
     return EFI_DEVICE_ERROR;
   } else {
@@ -638,6 +1113,7 @@ MonzaXIoRead (
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Write data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 EFI_STATUS
@@ -652,11 +1128,25 @@ MonzaXIoWrite (
   MONZAX_DEV           *Dev;
   UINTN                TransferDataLen;
   UINTN                ExpectDataLen;
+  UINTN                TransferCount;
 
   Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (This);
+  PERF_START_EX (Dev->Handle, MONZAX_PERF_TOKEN_WRITE, NULL, 0, 0);
+  EfiAcquireLock (&Dev->TransferLock);
+  Dev->IoCallCount++;
+  if (EFI_ERROR (MonzaxProbe (&Dev->Probe))) {
+    EfiReleaseLock (&Dev->TransferLock);
+    PERF_END_EX (Dev->Handle, MONZAX_PERF_TOKEN_WRITE, NULL, 0, 0);
+    *DataLen = 0;
+    return EFI_DEVICE_ERROR;
+  }
   ExpectDataLen = *DataLen;
+  TransferCount = Dev->QueueRequestCount;
   TransferDataLen = MonzaxWriteAddress (Dev, Address, Data, *DataLen);
+  EfiReleaseLock (&Dev->TransferLock);
+  PERF_END_EX (Dev->Handle, MONZAX_PERF_TOKEN_WRITE, NULL, 0, 0);
   *DataLen = TransferDataLen;
+  DEBUG ((EFI_D_INFO, "MonzaXIoWrite - 0x%x bytes, 0x%x I2C requests\n", TransferDataLen, Dev->QueueRequestCount - TransferCount));
   if (TransferDataLen == 0) {
     return EFI_DEVICE_ERROR;
   } else {
@@ -664,3 +1154,31 @@ MonzaXIoWrite (
     return EFI_SUCCESS;
   }
 }
+
+/**
+
+  Drop cached MonzaX memory contents so that the next read goes to the chip.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of the first byte to drop.
+  @param DataLen    The number of bytes to drop. 0 drops the whole cache.
+
+  @retval EFI_SUCCESS            The range is no longer cached.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoInvalidateCache (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINTN                          DataLen
+  )
+{
+  MONZAX_DEV           *Dev;
+
+  Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (This);
+  EfiAcquireLock (&Dev->TransferLock);
+  MonzaxInvalidateCache (Dev, Address, DataLen);
+  EfiReleaseLock (&Dev->TransferLock);
+  return EFI_SUCCESS;
+}
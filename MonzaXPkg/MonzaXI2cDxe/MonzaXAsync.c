@@ -0,0 +1,544 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+
+#include "MonzaXDxe.h"
+
+/**
+
+  Queue the I2C request of a memory step.
+
+  The step is clipped at the 2K Dura 0xFF device ID boundary and, for writes,
+  at the end of the write page.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Request    The asynchronous request the step belongs to.
+  @param IsWrite    TRUE to write, FALSE to read.
+  @param Address    The memory address of the step.
+  @param Buffer     The data to write or the buffer to read into.
+  @param Length     The number of bytes left. Writes must be word sized.
+
+  @return the status of QueueRequest.
+
+**/
+EFI_STATUS
+QueueMemoryStep (
+  IN MONZAX_DEV            *Dev,
+  IN MONZAX_ASYNC_REQUEST  *Request,
+  IN BOOLEAN               IsWrite,
+  IN UINT16                Address,
+  IN UINT8                 *Buffer,
+  IN UINTN                 Length
+  )
+{
+  EFI_STATUS Status;
+  UINT8      I2cDeviceId;
+  UINT8      AddressLen;
+  UINT16     DeviceAddress;
+  UINTN      PageLeft;
+
+  I2cDeviceId = Request->I2cDeviceId;
+  DeviceAddress = Address;
+  if (Request->ChipModelType == MonzaX2KDura) {
+    AddressLen = 1;
+    // The lower bit of the device id is the upper bit of the address.
+    if (Address > 0xFF) {
+      I2cDeviceId++;
+      DeviceAddress = (UINT16)(DeviceAddress - 0x0100);
+    }
+    Length = MIN (Length, 0x100 - (UINTN)DeviceAddress);
+  } else {
+    AddressLen = 2;
+  }
+
+  if (AddressLen == 1) {
+    Request->Addr[0] = (UINT8) DeviceAddress;
+  } else {
+    Request->Addr[0] = (UINT8) (DeviceAddress >> 8);
+    Request->Addr[1] = (UINT8) DeviceAddress;
+  }
+
+  if (IsWrite) {
+    PageLeft = MONZAX_SIZE_BYTES_WRITE_PAGE - (Address % MONZAX_SIZE_BYTES_WRITE_PAGE);
+    Length = MIN (Length, PageLeft);
+    ASSERT ((Length % sizeof(UINT16)) == 0);
+
+    CopyMem (Request->Buffer, Request->Addr, AddressLen);
+    CopyMem (Request->Buffer + AddressLen, Buffer, Length);
+    Request->Packet.OperationCount = 1;
+    Request->Packet.Operation[0].Flags = 0; // ~I2C_FLAG_READ
+    Request->Packet.Operation[0].LengthInBytes = (UINT32)(AddressLen + Length);
+    Request->Packet.Operation[0].Buffer = Request->Buffer;
+  } else {
+    Request->Packet.OperationCount = 2;
+    Request->Packet.Operation[0].Flags = 0; // ~I2C_FLAG_READ
+    Request->Packet.Operation[0].LengthInBytes = (UINT32)AddressLen;
+    Request->Packet.Operation[0].Buffer = Request->Addr;
+    Request->Packet.Operation[1].Flags = I2C_FLAG_READ;
+    Request->Packet.Operation[1].LengthInBytes = (UINT32)Length;
+    Request->Packet.Operation[1].Buffer = Buffer;
+  }
+
+  Request->StepLen = Length;
+  Request->StepIsWrite = IsWrite;
+  Request->StepSlave = I2cDeviceId;
+  Request->StepAddress = DeviceAddress;
+  Request->StepStart = MONZAX_TRACE_BEGIN ();
+
+  Status = SelectMuxChannel (Dev, Request->MuxChannel);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // The step moves the address pointer of the chip behind the back of the
+  // synchronous reads.
+  //
+  Dev->ReadPointerValid = FALSE;
+
+  Dev->QueueRequestCount++;
+  return Dev->I2cIo->QueueRequest (
+                       Dev->I2cIo,
+                       FindSlaveAddressIndex (Dev, I2cDeviceId),
+                       Dev->AsyncEvent,
+                       (EFI_I2C_REQUEST_PACKET *)&Request->Packet,
+                       &Dev->AsyncI2cStatus
+                       );
+}
+
+/**
+
+  Queue the I2C request of the current step of a request.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Request    The asynchronous request.
+
+  @return the status of QueueRequest.
+
+**/
+EFI_STATUS
+QueueAsyncStep (
+  IN MONZAX_DEV            *Dev,
+  IN MONZAX_ASYNC_REQUEST  *Request
+  )
+{
+  UINT16     Address;
+
+  Address = (UINT16)(Request->Address + Request->Offset);
+
+  switch (Request->Step) {
+  case MonzaXAsyncStepHeadRead:
+    return QueueMemoryStep (Dev, Request, FALSE, (UINT16)(Address - 1), &Request->Word[0], 1);
+  case MonzaXAsyncStepHeadWrite:
+    Request->Word[1] = Request->Data[0];
+    return QueueMemoryStep (Dev, Request, TRUE, (UINT16)(Address - 1), Request->Word, sizeof(Request->Word));
+  case MonzaXAsyncStepBody:
+    return QueueMemoryStep (
+             Dev,
+             Request,
+             Request->IsWrite,
+             Address,
+             Request->Data + Request->Offset,
+             Request->BodyEnd - Request->Offset
+             );
+  case MonzaXAsyncStepTailRead:
+    return QueueMemoryStep (Dev, Request, FALSE, (UINT16)(Address + 1), &Request->Word[1], 1);
+  case MonzaXAsyncStepTailWrite:
+    Request->Word[0] = Request->Data[Request->Offset];
+    return QueueMemoryStep (Dev, Request, TRUE, Address, Request->Word, sizeof(Request->Word));
+  default:
+    ASSERT (FALSE);
+    return EFI_ABORTED;
+  }
+}
+
+/**
+
+  Move a request to its next step.
+
+  @param Request    The asynchronous request whose current step completed.
+
+**/
+VOID
+AdvanceAsyncStep (
+  IN MONZAX_ASYNC_REQUEST  *Request
+  )
+{
+  switch (Request->Step) {
+  case MonzaXAsyncStepHeadRead:
+    Request->Step = MonzaXAsyncStepHeadWrite;
+    return;
+  case MonzaXAsyncStepHeadWrite:
+    Request->Offset = 1;
+    break;
+  case MonzaXAsyncStepBody:
+    Request->Offset += Request->StepLen;
+    break;
+  case MonzaXAsyncStepTailRead:
+    Request->Step = MonzaXAsyncStepTailWrite;
+    return;
+  case MonzaXAsyncStepTailWrite:
+    Request->Offset = Request->DataLen;
+    break;
+  default:
+    ASSERT (FALSE);
+    break;
+  }
+
+  if (Request->Offset < Request->BodyEnd) {
+    Request->Step = MonzaXAsyncStepBody;
+  } else if (Request->Offset < Request->DataLen) {
+    Request->Step = MonzaXAsyncStepTailRead;
+  } else {
+    Request->Step = MonzaXAsyncStepDone;
+  }
+}
+
+/**
+
+  Complete a request and signal its token.
+
+  A write bypasses the memory cache, so the range it wrote is dropped from it.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Request    The asynchronous request.
+  @param Status     The status of the request.
+
+**/
+VOID
+CompleteAsyncRequest (
+  IN MONZAX_DEV            *Dev,
+  IN MONZAX_ASYNC_REQUEST  *Request,
+  IN EFI_STATUS            Status
+  )
+{
+  MONZAX_IO_TOKEN  *Token;
+
+  DEBUG ((EFI_D_INFO, "MonzaXAsync - Complete 0x%x bytes - %r\n", Request->Offset, Status));
+
+  if (Request->IsWrite) {
+    MonzaxInvalidateCache (Dev, Request->Address, Request->DataLen);
+  }
+
+  Token = Request->Token;
+  Token->DataLength = Request->Offset;
+  if (!EFI_ERROR (Status) && (Request->Offset == 0)) {
+    Status = EFI_DEVICE_ERROR;
+  }
+  Token->TransactionStatus = Status;
+  FreePool (Request);
+  gBS->SignalEvent (Token->Event);
+}
+
+/**
+
+  Start queued requests until one is in flight or the queue is empty.
+
+  The caller must hold Dev->AsyncLock.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+StartNextAsyncRequest (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  MONZAX_ASYNC_REQUEST  *Request;
+  EFI_STATUS            Status;
+
+  while ((Dev->ActiveRequest == NULL) && !IsListEmpty (&Dev->AsyncQueue)) {
+    Request = MONZAX_ASYNC_REQUEST_FROM_LINK (GetFirstNode (&Dev->AsyncQueue));
+    RemoveEntryList (&Request->Link);
+
+    Status = QueueAsyncStep (Dev, Request);
+    if (EFI_ERROR (Status)) {
+      CompleteAsyncRequest (Dev, Request, Status);
+      continue;
+    }
+    Dev->ActiveRequest = Request;
+  }
+}
+
+/**
+
+  Notification function of the completion event of an asynchronous step.
+
+  @param Event      The completion event.
+  @param Context    Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+EFIAPI
+AsyncStepNotify (
+  IN EFI_EVENT            Event,
+  IN VOID                 *Context
+  )
+{
+  MONZAX_DEV            *Dev;
+  MONZAX_ASYNC_REQUEST  *Request;
+  EFI_STATUS            Status;
+
+  Dev = (MONZAX_DEV *)Context;
+
+  EfiAcquireLock (&Dev->AsyncLock);
+
+  Request = Dev->ActiveRequest;
+  if (Request == NULL) {
+    EfiReleaseLock (&Dev->AsyncLock);
+    return;
+  }
+
+  Status = Dev->AsyncI2cStatus;
+  MONZAX_TRACE (
+    Dev,
+    Request->StepIsWrite ? MonzaXTraceI2cWrite : MonzaXTraceI2cRead,
+    Request->StepSlave,
+    Request->StepAddress,
+    EFI_ERROR (Status) ? 0 : Request->StepLen,
+    Status,
+    Request->StepStart
+    );
+  if (!EFI_ERROR (Status)) {
+    AdvanceAsyncStep (Request);
+    if (Request->Step != MonzaXAsyncStepDone) {
+      Status = QueueAsyncStep (Dev, Request);
+      if (!EFI_ERROR (Status)) {
+        EfiReleaseLock (&Dev->AsyncLock);
+        return;
+      }
+    }
+  } else {
+    DEBUG ((EFI_D_ERROR, "MonzaXAsync - Step %d - %r\n", Request->Step, Status));
+  }
+
+  Dev->ActiveRequest = NULL;
+  CompleteAsyncRequest (Dev, Request, Status);
+  StartNextAsyncRequest (Dev);
+
+  EfiReleaseLock (&Dev->AsyncLock);
+}
+
+/**
+
+  Queue an asynchronous read or write.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param IsWrite    TRUE to write, FALSE to read.
+  @param Address    The device address of MonzaX chip.
+  @param Data       The data buffer.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the request completes.
+
+  @retval EFI_SUCCESS            The request is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+  @retval EFI_OUT_OF_RESOURCES   The request cannot be queued.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+
+**/
+EFI_STATUS
+SubmitAsyncRequest (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  BOOLEAN                        IsWrite,
+  IN  UINT16                         Address,
+  IN  UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  )
+{
+  EFI_STATUS            Status;
+  MONZAX_DEV            *Dev;
+  MONZAX_ASYNC_REQUEST  *Request;
+
+  if ((Data == NULL) || (DataLen == 0) || (Token == NULL) || (Token->Event == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (This);
+
+  //
+  // The steps are addressed for the chip model, identify it first.
+  //
+  Request = AllocateZeroPool (sizeof (MONZAX_ASYNC_REQUEST));
+  if (Request == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  EfiAcquireLock (&Dev->TransferLock);
+  Dev->IoCallCount++;
+  Status = MonzaxProbe (&Dev->Probe);
+  Request->I2cDeviceId   = Dev->MonzaxI2cDeviceId;
+  Request->ChipModelType = Dev->ChipModelType;
+  Request->MuxChannel    = Dev->MuxChannel;
+  EfiReleaseLock (&Dev->TransferLock);
+  if (EFI_ERROR (Status)) {
+    FreePool (Request);
+    return EFI_DEVICE_ERROR;
+  }
+
+  Request->Signature = MONZAX_ASYNC_REQUEST_SIGNATURE;
+  Request->Token     = Token;
+  Request->IsWrite   = IsWrite;
+  Request->Address   = Address;
+  Request->Data      = Data;
+  Request->DataLen   = DataLen;
+
+  if (!IsWrite) {
+    Request->BodyEnd = DataLen;
+    Request->Step = MonzaXAsyncStepBody;
+  } else if ((Address % 2) > 0) {
+    // Write does not start on a word boundary. Merge with the previous byte.
+    Request->BodyEnd = 1 + ((DataLen - 1) & ~(UINTN)1);
+    Request->Step = MonzaXAsyncStepHeadRead;
+  } else {
+    Request->BodyEnd = DataLen & ~(UINTN)1;
+    Request->Step = (Request->BodyEnd != 0) ? MonzaXAsyncStepBody : MonzaXAsyncStepTailRead;
+  }
+
+  Token->TransactionStatus = EFI_NOT_READY;
+  Token->DataLength = 0;
+
+  EfiAcquireLock (&Dev->AsyncLock);
+  InsertTailList (&Dev->AsyncQueue, &Request->Link);
+  StartNextAsyncRequest (Dev);
+  EfiReleaseLock (&Dev->AsyncLock);
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Start reading data from MonzaX chip.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the read completes.
+
+  @retval EFI_SUCCESS            The read is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+  @retval EFI_OUT_OF_RESOURCES   The request cannot be queued.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoReadAsync (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  OUT UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  )
+{
+  return SubmitAsyncRequest (This, FALSE, Address, Data, DataLen, Token);
+}
+
+/**
+
+  Start writing data to MonzaX chip.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is written to.
+  @param Data       A pointer to the buffer of data that will be written to MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the write completes.
+
+  @retval EFI_SUCCESS            The write is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+  @retval EFI_OUT_OF_RESOURCES   The request cannot be queued.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoWriteAsync (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  )
+{
+  return SubmitAsyncRequest (This, TRUE, Address, Data, DataLen, Token);
+}
+
+/**
+
+  Set up the asynchronous request queue of a device.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @return the status of creating the completion event.
+
+**/
+EFI_STATUS
+MonzaXAsyncInit (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  EfiInitializeLock (&Dev->AsyncLock, TPL_CALLBACK);
+  InitializeListHead (&Dev->AsyncQueue);
+  Dev->ActiveRequest = NULL;
+
+  return gBS->CreateEvent (
+                EVT_NOTIFY_SIGNAL,
+                TPL_CALLBACK,
+                AsyncStepNotify,
+                Dev,
+                &Dev->AsyncEvent
+                );
+}
+
+/**
+
+  Release the asynchronous request queue of a device.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS        The queue is released.
+  @retval EFI_ACCESS_DENIED  Requests are still pending.
+
+**/
+EFI_STATUS
+MonzaXAsyncFini (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  if (Dev->AsyncEvent == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  EfiAcquireLock (&Dev->AsyncLock);
+  if ((Dev->ActiveRequest != NULL) || !IsListEmpty (&Dev->AsyncQueue)) {
+    EfiReleaseLock (&Dev->AsyncLock);
+    return EFI_ACCESS_DENIED;
+  }
+  EfiReleaseLock (&Dev->AsyncLock);
+
+  gBS->CloseEvent (Dev->AsyncEvent);
+  Dev->AsyncEvent = NULL;
+  return EFI_SUCCESS;
+}
@@ -28,18 +28,28 @@ EFI_DRIVER_BINDING_PROTOCOL gMonzaXDriverBinding = {
   MonzaXDriverBindingSupported,
   MonzaXDriverBindingStart,
   MonzaXDriverBindingStop,
-  0xa,
+  0xc,
   NULL,
   NULL
 };
 
 MONZAX_IO_PROTOCOL         mMonzaXIo = {
+  MONZAX_IO_PROTOCOL_REVISION,
   MonzaXIoGetInfo,
   MonzaXIoSetInfo,
   MonzaXIoRead,
-  MonzaXIoWrite
+  MonzaXIoWrite,
+  MonzaXIoReadAsync,
+  MonzaXIoWriteAsync,
+  MonzaXIoInvalidateCache
 };
 
+//
+// I2C device index, see MonzaXI2cDeviceIndexInit().
+//
+LIST_ENTRY                 mI2cDeviceIndex[MONZAX_I2C_DEVICE_INDEX_BUCKETS];
+VOID                       *mI2cEnumerateRegistration;
+
 
 /**
   Entrypoint of I2C MonzaX Driver.
@@ -72,6 +82,8 @@ MonzaXDriverBindingEntryPoint (
              );
   ASSERT_EFI_ERROR (Status);
 
+  MonzaXI2cDeviceIndexInit ();
+
   return EFI_SUCCESS;
 }
 
@@ -95,8 +107,24 @@ MonzaXDriverBindingSupported (
   IN EFI_DEVICE_PATH_PROTOCOL       *RemainingDevicePath
   )
 {
-  EFI_STATUS          Status;
-  EFI_I2C_IO_PROTOCOL *I2cIo;
+  EFI_STATUS             Status;
+  EFI_I2C_IO_PROTOCOL    *I2cIo;
+  MONZAX_I2C_DEVICE_PATH *Node;
+
+  //
+  // A non-end remaining device path must name one MonzaX chip.
+  //
+  if ((RemainingDevicePath != NULL) && !IsDevicePathEnd (RemainingDevicePath)) {
+    Node = (MONZAX_I2C_DEVICE_PATH *) RemainingDevicePath;
+    if ((DevicePathType (&Node->Vendor.Header) != HARDWARE_DEVICE_PATH) ||
+        (DevicePathSubType (&Node->Vendor.Header) != HW_VENDOR_DP) ||
+        (DevicePathNodeLength (&Node->Vendor.Header) != sizeof (MONZAX_I2C_DEVICE_PATH)) ||
+        !CompareGuid (&Node->Vendor.Guid, &gMonzaXI2cDeviceGuid) ||
+        !IsMonzaXDeviceId (Node->I2cDeviceId) ||
+        ((Node->MuxChannel != MONZAX_MUX_CHANNEL_NONE) && (Node->MuxChannel >= MONZAX_MUX_CHANNEL_MAX))) {
+      return EFI_UNSUPPORTED;
+    }
+  }
 
   Status = gBS->OpenProtocol (
                   Controller,
@@ -132,11 +160,322 @@ MonzaXDriverBindingSupported (
 }
 
 
+/**
+  Create a child for the MonzaX chip at one slave address.
+
+  The child handle carries a device path made of the I2C device path and a
+  MONZAX_I2C_DEVICE_PATH node, together with its own MonzaX IO and MonzaX
+  Trace Protocols. Only a chip that answers the read of its TID gets a
+  child. The rest of the probe, which warms up the cache, runs on first use
+  or when the probe timer expires.
+
+  @param  This                  The I2C MonzaX driver binding instance.
+  @param  Controller            The I2C device handle.
+  @param  I2cIo                 The I2C IO Protocol opened on Controller.
+  @param  I2cDevice             The I2C device described by I2cIo.
+  @param  ParentDevicePath      The device path of Controller.
+  @param  I2cDeviceId           The slave address of the chip.
+  @param  Mux                   The multiplexer in front of the chip, NULL if none.
+  @param  MuxChannel            The multiplexer channel of the chip.
+  @param  BusFrequency          The bus frequency set at start, 0 if unknown.
+
+  @retval EFI_SUCCESS           The child is created.
+  @retval EFI_NOT_FOUND         No MonzaX chip answers at I2cDeviceId on MuxChannel.
+  @retval EFI_OUT_OF_RESOURCES  Can't allocate memory resources.
+  @retval Others                The child handle can't be created.
+
+**/
+EFI_STATUS
+MonzaXCreateChild (
+  IN EFI_DRIVER_BINDING_PROTOCOL    *This,
+  IN EFI_HANDLE                     Controller,
+  IN EFI_I2C_IO_PROTOCOL            *I2cIo,
+  IN EFI_I2C_DEVICE                 *I2cDevice,
+  IN EFI_DEVICE_PATH_PROTOCOL       *ParentDevicePath,
+  IN UINT8                          I2cDeviceId,
+  IN MONZAX_MUX                     *Mux,
+  IN UINT8                          MuxChannel,
+  IN UINT32                         BusFrequency
+  )
+{
+  EFI_STATUS                  Status;
+  MONZAX_DEV                  *MonzaXDevice;
+  MONZAX_I2C_DEVICE_PATH      Node;
+  EFI_I2C_IO_PROTOCOL         *ChildI2cIo;
+  UINTN                       Index;
+
+  MonzaXDevice = AllocateZeroPool (sizeof (MONZAX_DEV));
+  if (MonzaXDevice == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+
+  MonzaXDevice->Signature         = MONZAX_DEV_SIGNATURE;
+  EfiInitializeLock (&MonzaXDevice->TransferLock, TPL_CALLBACK);
+  MonzaXDevice->I2cIo             = I2cIo;
+  MonzaXDevice->I2cDevice         = I2cDevice;
+  MonzaXDevice->BusFrequency      = BusFrequency;
+  MonzaXDevice->Mux               = Mux;
+  MonzaXDevice->MuxChannel        = MuxChannel;
+  CopyMem (&MonzaXDevice->MonzaXIo, &mMonzaXIo, sizeof(mMonzaXIo));
+  MonzaXDevice->ControllerHandle  = Controller;
+  MonzaxTraceInit (&MonzaXDevice->Trace);
+
+  Status = MonzaXAsyncInit (MonzaXDevice);
+  if (EFI_ERROR (Status)) {
+    goto ErrorExit;
+  }
+
+  for (Index = 0; Index < MONZAX_READ_SEGMENT_MAX; Index++) {
+    Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &MonzaXDevice->SegmentEvent[Index]);
+    if (EFI_ERROR (Status)) {
+      goto ErrorExit;
+    }
+  }
+
+  MonzaXDevice->MonzaxI2cDeviceId = I2cDeviceId;
+  MonzaXDevice->ChipModelType = MonzaX2KDura;
+  Status = MonzaxProbeInit (
+             &MonzaXDevice->Probe,
+             &MonzaXDevice->Handle,
+             &MonzaXDevice->TransferLock,
+             &MonzaXDevice->ChipModelType,
+             MonzaxProbeRead,
+             MonzaxProbeComplete,
+             MonzaXDevice
+             );
+  if (EFI_ERROR (Status)) {
+    goto ErrorExit;
+  }
+
+  //
+  // SlaveAddressArray and the channel mask only say where a chip may be.
+  // Skip the addresses nobody answers, so that no MonzaX IO is published
+  // with nothing behind it. The TID read is short; the cache warm-up of the
+  // probe stays off the boot path.
+  //
+  EfiAcquireLock (&MonzaXDevice->TransferLock);
+  Status = MonzaxDetectChipModel (MonzaxProbeRead, MonzaXDevice, &MonzaXDevice->ChipModelType);
+  EfiReleaseLock (&MonzaXDevice->TransferLock);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_INFO, "MonzaXCreateChild - 0x%02x, channel %d - no chip\n", I2cDeviceId, MuxChannel));
+    goto ErrorExit;
+  }
+
+  ZeroMem (&Node, sizeof (Node));
+  Node.Vendor.Header.Type    = HARDWARE_DEVICE_PATH;
+  Node.Vendor.Header.SubType = HW_VENDOR_DP;
+  SetDevicePathNodeLength (&Node.Vendor.Header, sizeof (Node));
+  CopyGuid (&Node.Vendor.Guid, &gMonzaXI2cDeviceGuid);
+  Node.I2cDeviceId           = I2cDeviceId;
+  Node.MuxChannel            = MuxChannel;
+
+  MonzaXDevice->DevicePath = AppendDevicePathNode (ParentDevicePath, &Node.Vendor.Header);
+  if (MonzaXDevice->DevicePath == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto ErrorExit;
+  }
+
+  Status = gBS->InstallMultipleProtocolInterfaces (
+                  &MonzaXDevice->Handle,
+                  &gEfiDevicePathProtocolGuid,
+                  MonzaXDevice->DevicePath,
+                  &gMonzaXIoProtocolGuid,
+                  &MonzaXDevice->MonzaXIo,
+                  &gMonzaXTraceProtocolGuid,
+                  &MonzaXDevice->Trace.Protocol,
+                  NULL
+                  );
+
+  if (EFI_ERROR (Status)) {
+    goto ErrorExit;
+  }
+
+  //
+  // Open For Child Device
+  //
+  Status = gBS->OpenProtocol (
+                  Controller,
+                  &gEfiI2cIoProtocolGuid,
+                  (VOID **) &ChildI2cIo,
+                  This->DriverBindingHandle,
+                  MonzaXDevice->Handle,
+                  EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER
+                  );
+  if (EFI_ERROR (Status)) {
+    gBS->UninstallMultipleProtocolInterfaces (
+           MonzaXDevice->Handle,
+           &gEfiDevicePathProtocolGuid,
+           MonzaXDevice->DevicePath,
+           &gMonzaXIoProtocolGuid,
+           &MonzaXDevice->MonzaXIo,
+           &gMonzaXTraceProtocolGuid,
+           &MonzaXDevice->Trace.Protocol,
+           NULL
+           );
+    goto ErrorExit;
+  }
+
+  gBS->SetTimer (MonzaXDevice->Probe.Event, TimerRelative, MONZAX_PROBE_DELAY);
+
+  if (Mux != NULL) {
+    Mux->RefCount++;
+  }
+
+  MonzaXDevice->ControllerNameTable = NULL;
+  AddUnicodeString2 (
+    "eng",
+    gMonzaXComponentName.SupportedLanguages,
+    &MonzaXDevice->ControllerNameTable,
+    L"Generic MonzaX I2C",
+    TRUE
+    );
+  AddUnicodeString2 (
+    "en",
+    gMonzaXComponentName2.SupportedLanguages,
+    &MonzaXDevice->ControllerNameTable,
+    L"Generic MonzaX I2C",
+    FALSE
+    );
+
+  return EFI_SUCCESS;
+
+//
+// Error handler
+//
+ErrorExit:
+  if (MonzaXDevice->Probe.Event != NULL) {
+    gBS->CloseEvent (MonzaXDevice->Probe.Event);
+  }
+  MonzaXAsyncFini (MonzaXDevice);
+  for (Index = 0; Index < MONZAX_READ_SEGMENT_MAX; Index++) {
+    if (MonzaXDevice->SegmentEvent[Index] != NULL) {
+      gBS->CloseEvent (MonzaXDevice->SegmentEvent[Index]);
+    }
+  }
+  if (MonzaXDevice->DevicePath != NULL) {
+    FreePool (MonzaXDevice->DevicePath);
+  }
+  FreePool (MonzaXDevice);
+
+  return Status;
+}
+
+
+/**
+  Destroy one MonzaX child created by MonzaXCreateChild().
+
+  @param  This                  The I2C MonzaX driver binding instance.
+  @param  Controller            The I2C device handle.
+  @param  ChildHandle           The MonzaX child handle.
+
+  @retval EFI_SUCCESS           The child is destroyed.
+  @retval EFI_UNSUPPORTED       MonzaX IO Protocol is not installed on ChildHandle.
+  @retval Others                The child is busy and is left running.
+
+**/
+EFI_STATUS
+MonzaXDestroyChild (
+  IN EFI_DRIVER_BINDING_PROTOCOL    *This,
+  IN EFI_HANDLE                     Controller,
+  IN EFI_HANDLE                     ChildHandle
+  )
+{
+  EFI_STATUS                  Status;
+  MONZAX_DEV                  *MonzaXDevice;
+  MONZAX_IO_PROTOCOL          *MonzaX;
+  EFI_I2C_IO_PROTOCOL         *ChildI2cIo;
+  UINTN                       Index;
+
+  Status = gBS->OpenProtocol (
+                  ChildHandle,
+                  &gMonzaXIoProtocolGuid,
+                  (VOID **) &MonzaX,
+                  This->DriverBindingHandle,
+                  Controller,
+                  EFI_OPEN_PROTOCOL_GET_PROTOCOL
+                  );
+
+  if (EFI_ERROR (Status)) {
+    return EFI_UNSUPPORTED;
+  }
+
+  MonzaXDevice = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (MonzaX);
+
+  //
+  // Queued requests still point to the device.
+  //
+  Status = MonzaXAsyncFini (MonzaXDevice);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  gBS->CloseProtocol (
+         Controller,
+         &gEfiI2cIoProtocolGuid,
+         This->DriverBindingHandle,
+         ChildHandle
+         );
+
+  Status = gBS->UninstallMultipleProtocolInterfaces (
+                  ChildHandle,
+                  &gEfiDevicePathProtocolGuid,
+                  MonzaXDevice->DevicePath,
+                  &gMonzaXIoProtocolGuid,
+                  &MonzaXDevice->MonzaXIo,
+                  &gMonzaXTraceProtocolGuid,
+                  &MonzaXDevice->Trace.Protocol,
+                  NULL
+                  );
+  if (EFI_ERROR (Status)) {
+    gBS->OpenProtocol (
+           Controller,
+           &gEfiI2cIoProtocolGuid,
+           (VOID **) &ChildI2cIo,
+           This->DriverBindingHandle,
+           ChildHandle,
+           EFI_OPEN_PROTOCOL_BY_CHILD_CONTROLLER
+           );
+    MonzaXAsyncInit (MonzaXDevice);
+    return Status;
+  }
+
+  //
+  // Free all resources.
+  //
+  if (MonzaXDevice->ControllerNameTable != NULL) {
+    FreeUnicodeStringTable (MonzaXDevice->ControllerNameTable);
+  }
+
+  gBS->CloseEvent (MonzaXDevice->Probe.Event);
+  for (Index = 0; Index < MONZAX_READ_SEGMENT_MAX; Index++) {
+    gBS->CloseEvent (MonzaXDevice->SegmentEvent[Index]);
+  }
+
+  //
+  // The last child of the bus frees the multiplexer.
+  //
+  if (MonzaXDevice->Mux != NULL) {
+    MonzaXDevice->Mux->RefCount--;
+    if (MonzaXDevice->Mux->RefCount == 0) {
+      FreePool (MonzaXDevice->Mux);
+    }
+  }
+
+  FreePool (MonzaXDevice->DevicePath);
+  FreePool (MonzaXDevice);
+
+  return EFI_SUCCESS;
+}
+
+
 /**
   Starts the MonzaX device with this driver.
 
-  This function consumes I2C Bus Portocol, intializes I2C MonzaX device,
-  installs MonzaX IO Protocol.
+  This function consumes I2C Bus Portocol and creates a child with MonzaX IO
+  Protocol for every MonzaX device ID listed in the I2C device slave address
+  array. When PcdMonzaXMuxAddress is listed there too, a child is created for
+  every MonzaX device ID on every channel of PcdMonzaXMuxChannelMask. The
+  chips are probed later, see MonzaXCreateChild().
 
   @param  This                  The I2C MonzaX driver binding instance.
   @param  Controller            Handle of device to bind driver to.
@@ -160,14 +499,20 @@ MonzaXDriverBindingStart (
 {
   EFI_STATUS                  Status;
   EFI_I2C_IO_PROTOCOL         *I2cIo;
-  MONZAX_DEV                  *MonzaXDevice;
+  EFI_I2C_DEVICE              *I2cDevice;
   EFI_DEVICE_PATH             *DevicePath;
   EFI_TPL                     OldTpl;
-  UINT8                       Result;
+  UINT8                       I2cDeviceId;
+  UINT32                      BusFrequency;
+  MONZAX_MUX                  *Mux;
+  UINT8                       MuxAddress;
+  UINT8                       MuxChannel;
+  UINT8                       Channel;
+  UINTN                       ChildCount;
+  UINTN                       Index;
 
   DEBUG ((EFI_D_ERROR, "MonzaXDriverBindingStart: Enter\n"));
-
-  MonzaXDevice = NULL;
+  PERF_START_EX (Controller, MONZAX_PERF_TOKEN_START, NULL, 0, 0);
 
   OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
   //
@@ -201,64 +546,97 @@ MonzaXDriverBindingStart (
     goto ErrorExit;
   }
 
-  MonzaXDevice = AllocateZeroPool (sizeof (MONZAX_DEV));
-  ASSERT (MonzaXDevice != NULL);
-
-  MonzaXDevice->Signature         = MONZAX_DEV_SIGNATURE;
-  MonzaXDevice->I2cIo             = I2cIo;
-  MonzaXDevice->I2cDevice         = GetMonzaXI2cDevice (I2cIo);
-  ASSERT (MonzaXDevice->I2cDevice != NULL);
-  CopyMem (&MonzaXDevice->MonzaXIo, &mMonzaXIo, sizeof(mMonzaXIo));
-  MonzaXDevice->DevicePath        = DevicePath;
-  MonzaXDevice->ControllerHandle  = Controller;
-
-  DEBUG ((EFI_D_INFO, "MonzaxChipTest\n"));
-  // Hardcode
-  MonzaXDevice->MonzaxI2cDeviceId = MONZAX_I2C_DEVICE_ID_DEFAULT;
-  MonzaXDevice->ChipModelType = MonzaX2KDura;
-  Result = MonzaxChipTest (&MonzaXDevice->MonzaXIo);
-  if (Result == 0) {
-    DEBUG ((EFI_D_INFO, "MonzaxChipTest - PASS!\n"));
-  } else {
-    DEBUG ((EFI_D_INFO, "MonzaxChipTest - FAIL!\n"));
+  I2cDevice = GetMonzaXI2cDevice (I2cIo);
+  if (I2cDevice == NULL) {
     Status = EFI_UNSUPPORTED;
     goto ErrorExit;
   }
 
-  Status = gBS->InstallMultipleProtocolInterfaces (
-                  &Controller,
-                  &gMonzaXIoProtocolGuid,
-                  &MonzaXDevice->MonzaXIo,
-                  NULL
-                  );
-
-  if (EFI_ERROR (Status)) {
-    goto ErrorExit;
+  //
+  // An end node as remaining device path asks for no child at all.
+  //
+  if ((RemainingDevicePath != NULL) && IsDevicePathEnd (RemainingDevicePath)) {
+    gBS->RestoreTPL (OldTpl);
+    PERF_END_EX (Controller, MONZAX_PERF_TOKEN_START, NULL, 0, 0);
+    return EFI_SUCCESS;
   }
 
   //
-  // Open For Child Device
+  // Done before the children exist, so no MonzaX request is on the bus.
   //
+  BusFrequency = SetI2cBusFrequency (DevicePath);
 
-  MonzaXDevice->ControllerNameTable = NULL;
-  AddUnicodeString2 (
-    "eng",
-    gMonzaXComponentName.SupportedLanguages,
-    &MonzaXDevice->ControllerNameTable,
-    L"Generic MonzaX I2C",
-    TRUE
-    );
-  AddUnicodeString2 (
-    "en",
-    gMonzaXComponentName2.SupportedLanguages,
-    &MonzaXDevice->ControllerNameTable,
-    L"Generic MonzaX I2C",
-    FALSE
-    );
+  //
+  // The multiplexer is only reachable through this I2C device if its
+  // address is listed with the chips.
+  //
+  Mux = NULL;
+  MuxAddress = PcdGet8 (PcdMonzaXMuxAddress);
+  if (MuxAddress != 0) {
+    for (Index = 0; Index < I2cDevice->SlaveAddressCount; Index++) {
+      if ((UINT8) I2cDevice->SlaveAddressArray[Index] == MuxAddress) {
+        break;
+      }
+    }
+    if (Index < I2cDevice->SlaveAddressCount) {
+      Mux = AllocateZeroPool (sizeof (MONZAX_MUX));
+      if (Mux == NULL) {
+        Status = EFI_OUT_OF_RESOURCES;
+        goto ErrorExit;
+      }
+      Mux->SlaveAddress      = MuxAddress;
+      Mux->SlaveAddressIndex = Index;
+      Mux->Channel           = MONZAX_MUX_CHANNEL_NONE;
+    }
+  }
+
+  ChildCount = 0;
+  for (Channel = 0; Channel < MONZAX_MUX_CHANNEL_MAX; Channel++) {
+    if (Mux == NULL) {
+      MuxChannel = MONZAX_MUX_CHANNEL_NONE;
+    } else if ((PcdGet8 (PcdMonzaXMuxChannelMask) & (1 << Channel)) != 0) {
+      MuxChannel = Channel;
+    } else {
+      continue;
+    }
+
+    for (Index = 0; Index < I2cDevice->SlaveAddressCount; Index++) {
+      I2cDeviceId = (UINT8) I2cDevice->SlaveAddressArray[Index];
+      if (!IsMonzaXDeviceId (I2cDeviceId)) {
+        continue;
+      }
+      if ((RemainingDevicePath != NULL) &&
+          ((((MONZAX_I2C_DEVICE_PATH *) RemainingDevicePath)->I2cDeviceId != I2cDeviceId) ||
+           (((MONZAX_I2C_DEVICE_PATH *) RemainingDevicePath)->MuxChannel != MuxChannel))) {
+        continue;
+      }
+
+      Status = MonzaXCreateChild (This, Controller, I2cIo, I2cDevice, DevicePath, I2cDeviceId, Mux, MuxChannel, BusFrequency);
+      if (!EFI_ERROR (Status)) {
+        ChildCount++;
+      }
+    }
+
+    //
+    // Without a multiplexer there is a single pass.
+    //
+    if (Mux == NULL) {
+      break;
+    }
+  }
+
+  if (ChildCount == 0) {
+    if (Mux != NULL) {
+      FreePool (Mux);
+    }
+    Status = EFI_UNSUPPORTED;
+    goto ErrorExit;
+  }
 
   gBS->RestoreTPL (OldTpl);
 
-  DEBUG ((EFI_D_ERROR, "MonzaXDriverBindingStart: Exit\n"));
+  DEBUG ((EFI_D_ERROR, "MonzaXDriverBindingStart: Exit - %d chip(s)\n", (UINT32) ChildCount));
+  PERF_END_EX (Controller, MONZAX_PERF_TOKEN_START, NULL, 0, 0);
 
   return EFI_SUCCESS;
 
@@ -273,17 +651,13 @@ ErrorExit:
           This->DriverBindingHandle,
           Controller
           );
-
-    if (MonzaXDevice != NULL) {
-      FreePool (MonzaXDevice);
-      MonzaXDevice = NULL;
-    }
   }
 
 ErrorExit1:
   gBS->RestoreTPL (OldTpl);
 
   DEBUG ((EFI_D_ERROR, "MonzaXDriverBindingStart: Exit - %r\n", Status));
+  PERF_END_EX (Controller, MONZAX_PERF_TOKEN_START, NULL, 0, 0);
   return Status;
 }
 
@@ -297,8 +671,7 @@ ErrorExit1:
   @param  ChildHandleBuffer      The array of child handle.
 
   @retval EFI_SUCCESS            The device was stopped.
-  @retval EFI_UNSUPPORTED        MonzaX IO Protocol is not installed on Controller.
-  @retval Others                 Fail to uninstall protocols attached on the device.
+  @retval EFI_DEVICE_ERROR       At least one MonzaX child could not be stopped.
 
 **/
 EFI_STATUS
@@ -311,52 +684,32 @@ MonzaXDriverBindingStop (
   )
 {
   EFI_STATUS                  Status;
-  MONZAX_DEV                  *MonzaXDevice;
-  MONZAX_IO_PROTOCOL          *MonzaX;
+  BOOLEAN                     AllChildrenStopped;
+  UINTN                       Index;
 
-  Status = gBS->OpenProtocol (
-                  Controller,
-                  &gMonzaXIoProtocolGuid,
-                  (VOID **) &MonzaX,
-                  This->DriverBindingHandle,
-                  Controller,
-                  EFI_OPEN_PROTOCOL_GET_PROTOCOL
-                  );
-
-  if (EFI_ERROR (Status)) {
-    return EFI_UNSUPPORTED;
+  if (NumberOfChildren == 0) {
+    gBS->CloseProtocol (
+           Controller,
+           &gEfiI2cIoProtocolGuid,
+           This->DriverBindingHandle,
+           Controller
+           );
+    return EFI_SUCCESS;
   }
 
-  MonzaXDevice = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (MonzaX);
-
-  Status = gBS->UninstallMultipleProtocolInterfaces (
-                  Controller,
-                  &gMonzaXIoProtocolGuid,
-                  &MonzaXDevice->MonzaXIo,
-                  NULL
-                  );
-  if (EFI_ERROR (Status)) {
-    return Status;
+  AllChildrenStopped = TRUE;
+  for (Index = 0; Index < NumberOfChildren; Index++) {
+    Status = MonzaXDestroyChild (This, Controller, ChildHandleBuffer[Index]);
+    if (EFI_ERROR (Status)) {
+      AllChildrenStopped = FALSE;
+    }
   }
 
-  gBS->CloseProtocol (
-         Controller,
-         &gEfiI2cIoProtocolGuid,
-         This->DriverBindingHandle,
-         Controller
-         );
-
-  //
-  // Free all resources.
-  //
-  if (MonzaXDevice->ControllerNameTable != NULL) {
-    FreeUnicodeStringTable (MonzaXDevice->ControllerNameTable);
+  if (!AllChildrenStopped) {
+    return EFI_DEVICE_ERROR;
   }
 
-  FreePool (MonzaXDevice);
-
   return EFI_SUCCESS;
-
 }
 
 /**
@@ -382,21 +735,226 @@ IsMonzaXI2c (
 }
 
 /**
-  Return MonzaX I2C device structure.
+  Return the bucket of the I2C device index holding a device.
 
-  @param I2cIo             I2C IO instance
+  @param DeviceGuid   The DeviceGuid of the device.
+  @param DeviceIndex  The DeviceIndex of the device.
 
-  @return MonzaX I2C device structure.
-  @retval NULL This is not MonzaX I2C device.
+  @return The bucket index.
 **/
-EFI_I2C_DEVICE *
-GetMonzaXI2cDevice (
-  IN EFI_I2C_IO_PROTOCOL *I2cIo
+UINTN
+GetI2cDeviceIndexBucket (
+  IN CONST EFI_GUID *DeviceGuid,
+  IN UINT32         DeviceIndex
+  )
+{
+  return (DeviceGuid->Data1 ^ DeviceIndex) % MONZAX_I2C_DEVICE_INDEX_BUCKETS;
+}
+
+/**
+  Remove the devices of the I2C enumerate protocol on a handle from the I2C
+  device index.
+
+  @param Handle  The handle of the I2C enumerate protocol.
+**/
+VOID
+RemoveI2cEnumerate (
+  IN EFI_HANDLE Handle
+  )
+{
+  UINTN                      Index;
+  LIST_ENTRY                 *Link;
+  LIST_ENTRY                 *NextLink;
+  MONZAX_I2C_DEVICE_ENTRY    *Entry;
+
+  for (Index = 0; Index < MONZAX_I2C_DEVICE_INDEX_BUCKETS; Index++) {
+    for (Link = GetFirstNode (&mI2cDeviceIndex[Index]);
+         !IsNull (&mI2cDeviceIndex[Index], Link);
+         Link = NextLink) {
+      NextLink = GetNextNode (&mI2cDeviceIndex[Index], Link);
+      Entry = MONZAX_I2C_DEVICE_ENTRY_FROM_LINK (Link);
+      if (Entry->Handle == Handle) {
+        RemoveEntryList (&Entry->Link);
+        FreePool (Entry);
+      }
+    }
+  }
+}
+
+/**
+  Return if the I2C enumerate protocol an entry was taken from is still
+  installed, so that its device structure is still valid.
+
+  @param Entry  The entry of the I2C device index.
+
+  @retval TRUE  The entry is current.
+  @retval FALSE The protocol is uninstalled or replaced.
+**/
+BOOLEAN
+IsI2cDeviceEntryCurrent (
+  IN MONZAX_I2C_DEVICE_ENTRY *Entry
   )
 {
   EFI_STATUS                 Status;
   EFI_I2C_ENUMERATE_PROTOCOL *I2cEnumerate;
+
+  Status = gBS->HandleProtocol (Entry->Handle, &gEfiI2cEnumerateProtocolGuid, (VOID **)&I2cEnumerate);
+  return (BOOLEAN)(!EFI_ERROR (Status) && (I2cEnumerate == Entry->I2cEnumerate));
+}
+
+/**
+  Find a device in the I2C device index.
+
+  The devices of an I2C enumerate protocol that is no longer installed are
+  dropped from the index on the way.
+
+  @param DeviceGuid   The DeviceGuid of the device.
+  @param DeviceIndex  The DeviceIndex of the device.
+
+  @return The I2C device structure.
+  @retval NULL The device is not in the index.
+**/
+CONST EFI_I2C_DEVICE *
+FindI2cDevice (
+  IN CONST EFI_GUID *DeviceGuid,
+  IN UINT32         DeviceIndex
+  )
+{
+  LIST_ENTRY                 *Bucket;
+  LIST_ENTRY                 *Link;
+  MONZAX_I2C_DEVICE_ENTRY    *Entry;
+
+  Bucket = &mI2cDeviceIndex[GetI2cDeviceIndexBucket (DeviceGuid, DeviceIndex)];
+  Link = GetFirstNode (Bucket);
+  while (!IsNull (Bucket, Link)) {
+    Entry = MONZAX_I2C_DEVICE_ENTRY_FROM_LINK (Link);
+    if (!IsI2cDeviceEntryCurrent (Entry)) {
+      //
+      // Entry->Device may be freed, do not look at it. The removal may take
+      // other entries of the bucket too, so start over.
+      //
+      RemoveI2cEnumerate (Entry->Handle);
+      Link = GetFirstNode (Bucket);
+      continue;
+    }
+    if ((Entry->Device->DeviceIndex == DeviceIndex) && CompareGuid (Entry->Device->DeviceGuid, DeviceGuid)) {
+      return Entry->Device;
+    }
+    Link = GetNextNode (Bucket, Link);
+  }
+  return NULL;
+}
+
+/**
+  Add the devices of an I2C enumerate protocol to the I2C device index.
+
+  The devices indexed before for the same handle are replaced, so that a
+  reinstalled protocol does not leave entries of its former instance.
+
+  @param Handle        The handle of the I2C enumerate protocol.
+  @param I2cEnumerate  I2C enumerate instance
+**/
+VOID
+AddI2cEnumerate (
+  IN EFI_HANDLE                 Handle,
+  IN EFI_I2C_ENUMERATE_PROTOCOL *I2cEnumerate
+  )
+{
+  EFI_STATUS                 Status;
   CONST EFI_I2C_DEVICE       *Device;
+  MONZAX_I2C_DEVICE_ENTRY    *Entry;
+
+  RemoveI2cEnumerate (Handle);
+
+  //
+  //  Walk the list of I2C devices on this bus
+  //
+  Device = NULL;
+  while (TRUE) {
+    //
+    //  Get the next I2C device
+    //
+    Status = I2cEnumerate->Enumerate (I2cEnumerate, &Device);
+    if (EFI_ERROR(Status) || (Device == NULL)) {
+      break;
+    }
+    //
+    //  Determine if the device info is valid
+    //
+    if ((Device->DeviceGuid == NULL) || (Device->SlaveAddressCount == 0) || (Device->SlaveAddressArray == NULL)) {
+      continue;
+    }
+    //
+    // The first bus listing a device wins, as with a linear search.
+    //
+    if (FindI2cDevice (Device->DeviceGuid, Device->DeviceIndex) != NULL) {
+      continue;
+    }
+
+    Entry = AllocatePool (sizeof (MONZAX_I2C_DEVICE_ENTRY));
+    if (Entry == NULL) {
+      return;
+    }
+    Entry->Signature    = MONZAX_I2C_DEVICE_ENTRY_SIGNATURE;
+    Entry->Handle       = Handle;
+    Entry->I2cEnumerate = I2cEnumerate;
+    Entry->Device       = Device;
+    InsertTailList (
+      &mI2cDeviceIndex[GetI2cDeviceIndexBucket (Device->DeviceGuid, Device->DeviceIndex)],
+      &Entry->Link
+      );
+  }
+}
+
+/**
+  Add the devices of the I2C enumerate protocols installed or reinstalled
+  since the last call to the I2C device index.
+
+  @param Event    The protocol notify event.
+  @param Context  Not used.
+**/
+VOID
+EFIAPI
+I2cEnumerateNotify (
+  IN EFI_EVENT Event,
+  IN VOID      *Context
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_HANDLE                 Handle;
+  UINTN                      BufferSize;
+  EFI_I2C_ENUMERATE_PROTOCOL *I2cEnumerate;
+
+  while (TRUE) {
+    BufferSize = sizeof (Handle);
+    Status = gBS->LocateHandle (
+                    ByRegisterNotify,
+                    NULL,
+                    mI2cEnumerateRegistration,
+                    &BufferSize,
+                    &Handle
+                    );
+    if (EFI_ERROR (Status)) {
+      break;
+    }
+    Status = gBS->HandleProtocol (Handle, &gEfiI2cEnumerateProtocolGuid, (VOID **)&I2cEnumerate);
+    if (!EFI_ERROR (Status)) {
+      AddI2cEnumerate (Handle, I2cEnumerate);
+    }
+  }
+}
+
+/**
+  Add the devices of all installed I2C enumerate protocols to the I2C
+  device index.
+**/
+VOID
+AddAllI2cEnumerates (
+  VOID
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_I2C_ENUMERATE_PROTOCOL *I2cEnumerate;
   UINTN                      NoHandles;
   EFI_HANDLE                 *HandleBuffer;
   UINTN                      Index;
@@ -408,52 +966,159 @@ GetMonzaXI2cDevice (
                   &NoHandles,
                   &HandleBuffer
                   );
-  if (EFI_ERROR(Status)) {
-    return NULL;
+  if (!EFI_ERROR(Status)) {
+    for (Index = 0; Index < NoHandles; Index++) {
+      Status = gBS->HandleProtocol (HandleBuffer[Index], &gEfiI2cEnumerateProtocolGuid, (VOID **)&I2cEnumerate);
+      if (!EFI_ERROR(Status)) {
+        AddI2cEnumerate (HandleBuffer[Index], I2cEnumerate);
+      }
+    }
+    FreePool (HandleBuffer);
   }
+}
 
-  for (Index = 0; Index < NoHandles; Index++) {
-    Status = gBS->HandleProtocol (HandleBuffer[Index], &gEfiI2cEnumerateProtocolGuid, (VOID **)&I2cEnumerate);
-    if (EFI_ERROR(Status)) {
-      continue;
-    }
+/**
+  Build the I2C device index from the installed I2C enumerate protocols and
+  keep it up to date as more are installed.
+**/
+VOID
+MonzaXI2cDeviceIndexInit (
+  VOID
+  )
+{
+  UINTN                      Index;
+
+  for (Index = 0; Index < MONZAX_I2C_DEVICE_INDEX_BUCKETS; Index++) {
+    InitializeListHead (&mI2cDeviceIndex[Index]);
+  }
+
+  AddAllI2cEnumerates ();
+
+  //
+  // Buses that show up later are added, and reinstalled ones refreshed,
+  // from the protocol notify.
+  //
+  EfiCreateProtocolNotifyEvent (
+    &gEfiI2cEnumerateProtocolGuid,
+    TPL_CALLBACK,
+    I2cEnumerateNotify,
+    NULL,
+    &mI2cEnumerateRegistration
+    );
+}
+
+/**
+  Return MonzaX I2C device structure.
+
+  @param I2cIo             I2C IO instance
+
+  @return MonzaX I2C device structure.
+  @retval NULL This is not MonzaX I2C device.
+**/
+EFI_I2C_DEVICE *
+GetMonzaXI2cDevice (
+  IN EFI_I2C_IO_PROTOCOL *I2cIo
+  )
+{
+  CONST EFI_I2C_DEVICE       *Device;
 
+  Device = FindI2cDevice (I2cIo->DeviceGuid, I2cIo->DeviceIndex);
+  if (Device == NULL) {
     //
-    //  Walk the list of I2C devices on this bus
+    // Start runs at TPL_CALLBACK, so the notification of a bus installed
+    // meanwhile may still be pending. Catch up now.
     //
-    Device = NULL;
-    while (TRUE) {
-      //
-      //  Get the next I2C device
-      //
-      Status = I2cEnumerate->Enumerate (I2cEnumerate, &Device);
-      if (EFI_ERROR(Status) || (Device == NULL)) {
-        Device = NULL;
-        break;
-      }
-      //
-      //  Determine if the device info is valid
-      //
-      if ((Device->DeviceGuid == NULL) || (Device->SlaveAddressCount == 0) || (Device->SlaveAddressArray == NULL)) {
-        continue;
-      }
-
-      //
-      // Check if it matches current one.
-      //
-      if (CompareGuid(Device->DeviceGuid, I2cIo->DeviceGuid) && (Device->DeviceIndex == I2cIo->DeviceIndex)) {
-        //
-        // Found
-        //
-        break;
-      }
-    }
+    I2cEnumerateNotify (NULL, NULL);
+    Device = FindI2cDevice (I2cIo->DeviceGuid, I2cIo->DeviceIndex);
+  }
+  if (Device == NULL) {
     //
-    // If found, stop and return
+    // A device listed by two buses is only indexed for the first one. Once
+    // that one is uninstalled, the other has to be enumerated again.
     //
-    if (Device != NULL) {
-      return (EFI_I2C_DEVICE *)Device;
-    }
+    AddAllI2cEnumerates ();
+    Device = FindI2cDevice (I2cIo->DeviceGuid, I2cIo->DeviceIndex);
+  }
+  return (EFI_I2C_DEVICE *)Device;
+}
+
+/**
+  Ask the I2C master of the bus for the frequency in PcdMonzaXI2cBusFrequency.
+
+  The request is capped at the fastest mode of the chip, and the I2C master
+  sets the closest frequency it supports at or below it. The frequency is
+  the one of the whole bus, so the other devices on it run at it as well.
+
+  The I2C master cannot be asked for its frequency later. A platform whose
+  bus configuration management sits on the host controller may program the
+  frequency again whenever the I2C host switches bus configurations, so the
+  frequency set here is not reported then.
+
+  @param  DevicePath  The device path of the I2C device.
+
+  @return The bus frequency in Hz the I2C master has set, 0 if unknown.
+**/
+UINT32
+SetI2cBusFrequency (
+  IN EFI_DEVICE_PATH_PROTOCOL *DevicePath
+  )
+{
+  EFI_STATUS                 Status;
+  EFI_HANDLE                 Handle;
+  EFI_I2C_MASTER_PROTOCOL    *I2cMaster;
+  VOID                       *Interface;
+  UINTN                      BusClockHertz;
+
+  BusClockHertz = PcdGet32 (PcdMonzaXI2cBusFrequency);
+  if (BusClockHertz == 0) {
+    return 0;
+  }
+  BusClockHertz = MIN (BusClockHertz, MONZAX_I2C_BUS_FREQUENCY_MAX);
+
+  //
+  // The I2C master is on the host controller, up the device path.
+  //
+  Status = gBS->LocateDevicePath (&gEfiI2cMasterProtocolGuid, &DevicePath, &Handle);
+  if (!EFI_ERROR (Status)) {
+    Status = gBS->HandleProtocol (Handle, &gEfiI2cMasterProtocolGuid, (VOID **) &I2cMaster);
+  }
+  if (!EFI_ERROR (Status)) {
+    Status = I2cMaster->SetBusFrequency (I2cMaster, &BusClockHertz);
+  }
+  DEBUG ((EFI_D_INFO, "SetI2cBusFrequency - %r, %d Hz\n", Status, (UINT32) BusClockHertz));
+  if (EFI_ERROR (Status)) {
+    return 0;
+  }
+
+  Status = gBS->HandleProtocol (Handle, &gEfiI2cBusConfigurationManagementProtocolGuid, &Interface);
+  if (!EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_INFO, "SetI2cBusFrequency - the platform bus configuration may change it\n"));
+    return 0;
+  }
+
+  return (UINT32) BusClockHertz;
+}
+
+/**
+  Return if a slave address is one a MonzaX chip can be strapped to.
+
+  @param I2cDeviceId  I2C slave address
+
+  @retval TRUE  I2cDeviceId is a MonzaX device ID.
+  @retval FALSE I2cDeviceId is not a MonzaX device ID.
+**/
+BOOLEAN
+IsMonzaXDeviceId (
+  IN UINT8 I2cDeviceId
+  )
+{
+  switch (I2cDeviceId) {
+  case MONZAX_I2C_DEVICE_ID_1:
+  case MONZAX_I2C_DEVICE_ID_2:
+  case MONZAX_I2C_DEVICE_ID_3:
+  case MONZAX_I2C_DEVICE_ID_4:
+    return TRUE;
+  default:
+    return FALSE;
   }
-  return NULL;
 }
@@ -31,7 +31,10 @@ SOFTWARE.
 #include <Protocol/DevicePath.h>
 #include <Protocol/I2cIo.h>
 #include <Protocol/I2cEnumerate.h>
+#include <Protocol/I2cMaster.h>
+#include <Protocol/I2cBusConfigurationManagement.h>
 #include <Protocol/MonzaXIo.h>
+#include <Protocol/MonzaXTrace.h>
 #include <Guid/MonzaXI2cDevice.h>
 
 #include <Library/ReportStatusCodeLib.h>
@@ -42,25 +45,243 @@ SOFTWARE.
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/DebugLib.h>
+#include <Library/TimerLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PerformanceLib.h>
 #include <Library/MonzaXLib.h>
 
 #define I2C_TIMEOUT_DEFAULT     1000
 
+typedef struct {
+  ///
+  /// Number of elements in the operation array
+  ///
+  UINTN OperationCount;
+
+  ///
+  /// Description of the I2C operation
+  ///
+  EFI_I2C_OPERATION Operation[2];
+} I2C_REQUEST_PACKET_WRITE_READ;
+
 #define MONZAX_DEV_SIGNATURE SIGNATURE_32 ('m', 'z', 'x', 'i')
 
+//
+// Module index of the I2C devices listed by every I2C enumerate protocol,
+// hashed by DeviceGuid and DeviceIndex into MONZAX_I2C_DEVICE_INDEX_BUCKETS
+// lists. Device belongs to the I2cEnumerate instance on Handle, and is only
+// used while Handle still carries that instance.
+//
+#define MONZAX_I2C_DEVICE_INDEX_BUCKETS   16
+
+#define MONZAX_I2C_DEVICE_ENTRY_SIGNATURE SIGNATURE_32 ('m', 'z', 'x', 'e')
 typedef struct {
   UINTN                         Signature;
+  LIST_ENTRY                    Link;
+  EFI_HANDLE                    Handle;
+  EFI_I2C_ENUMERATE_PROTOCOL    *I2cEnumerate;
+  CONST EFI_I2C_DEVICE          *Device;
+} MONZAX_I2C_DEVICE_ENTRY;
+
+#define MONZAX_I2C_DEVICE_ENTRY_FROM_LINK(a) \
+    CR(a, MONZAX_I2C_DEVICE_ENTRY, Link, MONZAX_I2C_DEVICE_ENTRY_SIGNATURE)
+
+//
+// The I2C multiplexer of a bus, shared by the children of the bus. Channel
+// is the channel selected by the last select request queued, so that the
+// select is only sent when a chip on another channel is accessed. It is
+// MONZAX_MUX_CHANNEL_NONE when unknown. Every child holds a reference.
+//
+typedef struct {
+  UINT8                         SlaveAddress;
+  UINTN                         SlaveAddressIndex;
+  UINT8                         Channel;
+  UINTN                         RefCount;
+} MONZAX_MUX;
+
+//
+// Fastest I2C mode of the chip, Fast-mode.
+//
+#define MONZAX_I2C_BUS_FREQUENCY_MAX  400000
+
+//
+// A contiguous read from one slave. A 2K Dura read across 0xFF is two
+// segments, one per device ID.
+//
+#define MONZAX_READ_SEGMENT_MAX   2
+typedef struct {
+  UINT8           I2cDeviceId;
+  UINT16          Address;
+  UINT8           AddressLen;
+  UINT8           *Data;
+  UINTN           DataLen;
+} MONZAX_READ_SEGMENT;
+
+//
+// A write transaction carries up to a 2-byte memory address followed by at
+// most one write page of data.
+//
+#define MONZAX_WRITE_BUFFER_SIZE  (sizeof(UINT16) + MONZAX_SIZE_BYTES_WRITE_PAGE)
+
+#define MONZAX_ASYNC_REQUEST_SIGNATURE SIGNATURE_32 ('m', 'z', 'x', 'q')
+
+//
+// Steps of an asynchronous request. Reads only use the body step. Writes
+// merge a partial first or last word with the byte next to it, like the
+// synchronous path does.
+//
+typedef enum {
+  MonzaXAsyncStepHeadRead,    // read the byte before an odd start address
+  MonzaXAsyncStepHeadWrite,   // write the merged first word
+  MonzaXAsyncStepBody,        // read or write the word aligned part
+  MonzaXAsyncStepTailRead,    // read the byte after an odd end address
+  MonzaXAsyncStepTailWrite,   // write the merged last word
+  MonzaXAsyncStepDone
+} MONZAX_ASYNC_STEP;
 
+typedef struct {
+  UINTN                         Signature;
+  LIST_ENTRY                    Link;
+
+  MONZAX_IO_TOKEN               *Token;
+  BOOLEAN                       IsWrite;
+  UINT16                        Address;
+  UINT8                         *Data;
+  UINTN                         DataLen;
+
+  //
+  // Chip addressing taken when the request is submitted. A later SetInfo
+  // does not move a request that is already queued.
+  //
+  UINT8                         I2cDeviceId;
+  MONZAX_CHIP_MODEL_TYPE        ChipModelType;
+  UINT8                         MuxChannel;
+
+  MONZAX_ASYNC_STEP             Step;
+  UINTN                         Offset;     // bytes of Data done
+  UINTN                         BodyEnd;    // offset where the body step ends
+  UINTN                         StepLen;    // bytes of Data in the current step
+
+  //
+  // Trace record of the I2C request in flight.
+  //
+  BOOLEAN                       StepIsWrite;
+  UINT8                         StepSlave;
+  UINT16                        StepAddress;
+  UINT64                        StepStart;
+
+  //
+  // Buffers of the I2C request in flight. They must live until it completes.
+  //
+  I2C_REQUEST_PACKET_WRITE_READ Packet;
+  UINT8                         Addr[2];
+  UINT8                         Word[2];
+  UINT8                         Buffer[MONZAX_WRITE_BUFFER_SIZE];
+} MONZAX_ASYNC_REQUEST;
+
+#define MONZAX_ASYNC_REQUEST_FROM_LINK(a) \
+    CR(a, MONZAX_ASYNC_REQUEST, Link, MONZAX_ASYNC_REQUEST_SIGNATURE)
+
+//
+// The memory cache is filled in blocks, with one valid bit per block.
+//
+#define MONZAX_CACHE_BLOCK_SIZE   64
+#define MONZAX_CACHE_BLOCK_COUNT  ((MONZAX_SIZE_BYTES_MEMORY_8K + MONZAX_CACHE_BLOCK_SIZE - 1) / MONZAX_CACHE_BLOCK_SIZE)
+
+//
+// Tokens of the PerformanceLib records of the driver, as shown by dp.
+// Start is recorded on the controller handle, the probe and every MonzaX IO
+// read and write on the handle of the MonzaX IO protocol.
+//
+#define MONZAX_PERF_TOKEN_START   "MonzaX:Start"
+#define MONZAX_PERF_TOKEN_READ    "MonzaX:Read"
+#define MONZAX_PERF_TOKEN_WRITE   "MonzaX:Write"
+
+typedef struct {
+  UINTN                         Signature;
+
+  //
+  // ControllerHandle is the I2C device; Handle is the child created for
+  // this chip and carries DevicePath, MonzaXIo and Trace.
+  //
   EFI_HANDLE                    ControllerHandle;
+  EFI_HANDLE                    Handle;
   EFI_DEVICE_PATH_PROTOCOL      *DevicePath;
 
   EFI_I2C_IO_PROTOCOL           *I2cIo;
   EFI_I2C_DEVICE                *I2cDevice;
+  UINT32                        BusFrequency;   // set at start, 0 if unknown
+
+  //
+  // The multiplexer in front of the chip and the channel of the chip, or
+  // NULL and MONZAX_MUX_CHANNEL_NONE.
+  //
+  MONZAX_MUX                    *Mux;
+  UINT8                         MuxChannel;
 
   MONZAX_IO_PROTOCOL            MonzaXIo;
 
   UINT8                         MonzaxI2cDeviceId;
   MONZAX_CHIP_MODEL_TYPE        ChipModelType;
+  MONZAX_PROBE                  Probe;
+
+  //
+  // Transaction scope of the MonzaX IO calls and the probe timer. It is
+  // taken at TPL_CALLBACK, so MonzaX IO must not be called above that TPL.
+  //
+  EFI_LOCK                      TransferLock;
+
+  //
+  // Write-through cache of the chip memory, used when PcdMonzaXMemoryCache
+  // is TRUE. CacheGeneration changes on every invalidation, so a fill that
+  // raced with one does not mark its blocks valid.
+  //
+  UINT8                         Cache[MONZAX_SIZE_BYTES_MEMORY_8K];
+  UINT32                        CacheValid;
+  UINT32                        CacheGeneration;
+  UINT32                        CacheHits;
+  UINT32                        CacheMisses;
+
+  //
+  // Internal address pointer of the chip, for current address reads when
+  // PcdMonzaXSequentialRead is TRUE. A read from ReadPointerSlave continues
+  // at ReadPointer. Writes and failed reads leave it unknown.
+  //
+  BOOLEAN                       ReadPointerValid;
+  UINT8                         ReadPointerSlave;
+  UINT16                        ReadPointer;
+
+  //
+  // Number of MonzaX IO reads and writes, and of I2C requests they queued.
+  //
+  UINT32                        IoCallCount;
+  UINTN                         QueueRequestCount;
+
+  //
+  // Address and data of the write being issued. Writes are synchronous, so
+  // one buffer per device is enough.
+  //
+  UINT8                         WriteBuffer[MONZAX_WRITE_BUFFER_SIZE];
+
+  //
+  // Completion events of the segments of a synchronous read.
+  //
+  EFI_EVENT                     SegmentEvent[MONZAX_READ_SEGMENT_MAX];
+
+  //
+  // Asynchronous requests run one at a time, in queue order. AsyncEvent is
+  // signaled by the I2C stack when the step of ActiveRequest completes.
+  //
+  EFI_LOCK                      AsyncLock;
+  LIST_ENTRY                    AsyncQueue;
+  MONZAX_ASYNC_REQUEST          *ActiveRequest;
+  EFI_EVENT                     AsyncEvent;
+  EFI_STATUS                    AsyncI2cStatus;
+
+  //
+  // Trace ring, with the MONZAX_TRACE_PROTOCOL of the device.
+  //
+  MONZAX_TRACE_RING             Trace;
 
   EFI_UNICODE_STRING_TABLE      *ControllerNameTable;
 } MONZAX_DEV;
@@ -262,6 +483,15 @@ IsMonzaXI2c(
   IN EFI_I2C_IO_PROTOCOL *I2cIo
   );
 
+/**
+  Build the I2C device index from the installed I2C enumerate protocols and
+  keep it up to date as more are installed.
+**/
+VOID
+MonzaXI2cDeviceIndexInit (
+  VOID
+  );
+
 /**
   Return MonzaX I2C device structure.
 
@@ -275,6 +505,33 @@ GetMonzaXI2cDevice (
   IN EFI_I2C_IO_PROTOCOL *I2cIo
   );
 
+/**
+  Ask the I2C master of the bus for the frequency in PcdMonzaXI2cBusFrequency.
+  The frequency applies to every device on the bus.
+
+  @param DevicePath  The device path of the I2C device.
+
+  @return The bus frequency in Hz the I2C master has set, 0 if unknown or if
+          the platform bus configuration may change it.
+**/
+UINT32
+SetI2cBusFrequency (
+  IN EFI_DEVICE_PATH_PROTOCOL *DevicePath
+  );
+
+/**
+  Return if a slave address is one a MonzaX chip can be strapped to.
+
+  @param I2cDeviceId  I2C slave address
+
+  @retval TRUE  I2cDeviceId is a MonzaX device ID.
+  @retval FALSE I2cDeviceId is not a MonzaX device ID.
+**/
+BOOLEAN
+IsMonzaXDeviceId (
+  IN UINT8 I2cDeviceId
+  );
+
 /**
 
   Get MonzaX chip information.
@@ -303,6 +560,7 @@ MonzaXIoGetInfo (
 
   @retval EFI_SUCCESS            The MonzaX information is set.
   @retval EFI_INVALID_PARAMETER  Info is NULL.
+  @retval EFI_INVALID_PARAMETER  Info->MuxChannel is not a channel of the multiplexer.
 
 **/
 EFI_STATUS
@@ -327,6 +585,7 @@ MonzaXIoSetInfo (
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Read data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 EFI_STATUS
@@ -353,6 +612,7 @@ MonzaXIoRead (
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Write data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 EFI_STATUS
@@ -366,16 +626,199 @@ MonzaXIoWrite (
 
 /**
 
-  This function dump raw data with colume format.
+  Start reading data from MonzaX chip.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the read completes.
+
+  @retval EFI_SUCCESS            The read is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+  @retval EFI_OUT_OF_RESOURCES   The request cannot be queued.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoReadAsync (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  OUT UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  );
+
+/**
+
+  Start writing data to MonzaX chip.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is written to.
+  @param Data       A pointer to the buffer of data that will be written to MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the write completes.
+
+  @retval EFI_SUCCESS            The write is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+  @retval EFI_OUT_OF_RESOURCES   The request cannot be queued.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoWriteAsync (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  );
+
+/**
+
+  Drop cached MonzaX memory contents so that the next read goes to the chip.
 
-  @param  Data  raw data
-  @param  Size  raw data size
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of the first byte to drop.
+  @param DataLen    The number of bytes to drop. 0 drops the whole cache.
+
+  @retval EFI_SUCCESS            The range is no longer cached.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoInvalidateCache (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINTN                          DataLen
+  );
+
+/**
+  Select the multiplexer channel of the chip.
+
+  The select request is only sent when the channel differs from the one
+  selected last on the bus.
+
+  @param Dev          Pointer to the MONZAX_DEV instance.
+  @param Channel      The multiplexer channel.
+
+  @retval EFI_SUCCESS Channel is selected, or there is no multiplexer.
+  @retval Others      The select request failed.
+**/
+EFI_STATUS
+SelectMuxChannel (
+  IN MONZAX_DEV           *Dev,
+  IN UINT8                Channel
+  );
+
+/**
+  Get I2C slave address index of an I2C device ID.
+
+  @param Dev          Pointer to the MONZAX_DEV instance.
+  @param I2cDeviceId  The I2C device ID.
+
+  @return I2C slave address index of I2cDeviceId.
+**/
+UINTN
+FindSlaveAddressIndex (
+  IN MONZAX_DEV           *Dev,
+  IN UINT8                I2cDeviceId
+  );
+
+/**
+
+  Set up the asynchronous request queue of a device.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @return the status of creating the completion event.
+
+**/
+EFI_STATUS
+MonzaXAsyncInit (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Release the asynchronous request queue of a device.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS        The queue is released.
+  @retval EFI_ACCESS_DENIED  Requests are still pending.
+
+**/
+EFI_STATUS
+MonzaXAsyncFini (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Drop a range of the memory from the cache.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of the first byte.
+  @param DataLen    The number of bytes. 0 drops the whole cache.
 
 **/
 VOID
-InternalDumpHex (
-  IN UINT8  *Data,
-  IN UINTN  Size
+MonzaxInvalidateCache (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  IN UINTN                DataLen
+  );
+
+/**
+
+  Fill the cache with the whole memory of the chip.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+MonzaxWarmUpCache (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Read the TID of the chip for the probe, with the address layout of
+  Dev->ChipModelType.
+
+  @param Context    Pointer to the MONZAX_DEV instance.
+  @param Address    The memory address to start reading from.
+  @param Data       A buffer of bytes to hold the data.
+  @param DataLen    The number of bytes to read.
+
+  @return  The number of bytes read.
+
+**/
+UINTN
+EFIAPI
+MonzaxProbeRead (
+  IN  VOID                *Context,
+  IN  UINT16              Address,
+  OUT UINT8               *Data,
+  IN  UINTN               DataLen
+  );
+
+/**
+
+  Start over the memory cache once the chip model is identified.
+
+  @param Context    Pointer to the MONZAX_DEV instance.
+  @param Status     EFI_SUCCESS if the chip model is identified.
+
+**/
+VOID
+EFIAPI
+MonzaxProbeComplete (
+  IN  VOID                *Context,
+  IN  EFI_STATUS          Status
   );
 
 #endif
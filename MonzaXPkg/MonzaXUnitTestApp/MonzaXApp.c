@@ -25,6 +25,10 @@ SOFTWARE.
 #include <Uefi.h>
 
 #include <Protocol/MonzaXIo.h>
+#include <Protocol/MonzaXTrace.h>
+#include <Protocol/MonzaXNotify.h>
+#include <Protocol/MonzaXScheduler.h>
+#include <Protocol/MonzaXStatistics.h>
 
 #include <Library/ReportStatusCodeLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -214,6 +218,12 @@ PrintUsage (
   Print (L"33: Permalock User memory\n");
   Print (L"34: Enable Write Wakeup Mode (WWU)\n");
   Print (L"35: Disable Write Wakeup Mode (WWU)\n");
+  Print (L"36: Dump user memory and TID asynchronously\n");
+  Print (L"37: Dump transfer trace\n");
+  Print (L"38: Clear transfer trace\n");
+  Print (L"39: Wait for wake GPIO edge\n");
+  Print (L"40: Read TID and write/read back user memory of all USB devices through the scheduler\n");
+  Print (L"41: Dump bus statistics\n");
   Print (L"99: Exit\n");
 }
 
@@ -244,18 +254,43 @@ PrintInfo (
   IN MONZAX_IO_PROTOCOL *MonzaXIo
   )
 {
+  EFI_STATUS   Status;
   MONZAX_INFO  MonzaxInfo;
 
   MonzaxInfo.Revision = MONZAX_INFO_REVISION;
   MonzaxInfo.Length   = sizeof(MONZAX_INFO);
 
-  MonzaXIo->GetInfo (MonzaXIo, &MonzaxInfo);
+  Status = MonzaXIo->GetInfo (MonzaXIo, &MonzaxInfo);
+  if (EFI_ERROR (Status)) {
+    Print (L"\nGetInfo - %r\n\n", Status);
+    return;
+  }
   if (MonzaxInfo.ChipModelType == MonzaX2KDura) {
     Print(L"\nMonzaX 2K Dura");
   } else {
     Print(L"\nMonzaX 8K Dura");
   }
-  Print (L" detected at I2C address 0x%02X\n\n", MonzaxInfo.I2cDeviceId);
+  Print (L" detected at I2C address 0x%02X", MonzaxInfo.I2cDeviceId);
+  if ((MonzaxInfo.Revision >= MONZAX_INFO_REVISION_5) && (MonzaxInfo.MuxChannel != MONZAX_MUX_CHANNEL_NONE)) {
+    Print (L" on multiplexer channel %d", MonzaxInfo.MuxChannel);
+  }
+  Print (L"\n");
+  if ((MonzaxInfo.Revision >= MONZAX_INFO_REVISION_2) && (MonzaxInfo.BusFrequency != 0)) {
+    Print (L"Bus %d Hz, write timeout %d ms, read timeout %d ms, retry limit %d, SCL low timeout %s\n",
+      MonzaxInfo.BusFrequency,
+      MonzaxInfo.WriteTimeout,
+      MonzaxInfo.ReadTimeout,
+      MonzaxInfo.RetryLimit,
+      MonzaxInfo.SclLowTimeout ? L"on" : L"off"
+      );
+  }
+  if ((MonzaxInfo.Revision >= MONZAX_INFO_REVISION_3) && (MonzaxInfo.CacheHits + MonzaxInfo.CacheMisses != 0)) {
+    Print (L"Cache %d hits, %d misses\n", MonzaxInfo.CacheHits, MonzaxInfo.CacheMisses);
+  }
+  if ((MonzaxInfo.Revision >= MONZAX_INFO_REVISION_4) && (MonzaxInfo.IoCalls != 0)) {
+    Print (L"%d reads and writes, %d bus transfers\n", MonzaxInfo.IoCalls, MonzaxInfo.BusTransfers);
+  }
+  Print (L"\n");
 }
 
 /**
@@ -416,6 +451,454 @@ MonzaXReadTid (
   return Count;
 }
 
+/**
+  Dump user memory and TID with two outstanding asynchronous reads.
+
+  @param MonzaXIo   MonzaX IO instance
+**/
+VOID
+MonzaXAsyncDumpMemory (
+  IN MONZAX_IO_PROTOCOL *MonzaXIo
+  )
+{
+  EFI_STATUS        Status;
+  MONZAX_IO_TOKEN   UserToken;
+  MONZAX_IO_TOKEN   TidToken;
+  EFI_EVENT         Events[2];
+  UINTN             Index;
+  UINTN             UserSize;
+  UINTN             TidSize;
+  UINT8             UserBuffer[MONZAX_SIZE_BYTES_USER_8K];
+  UINT8             TidBuffer[MONZAX_SIZE_BYTES_TID];
+
+  if (MonzaXIo->Revision < MONZAX_IO_PROTOCOL_REVISION_2) {
+    Print (L"ReadAsync not supported by protocol revision 0x%lx\n", MonzaXIo->Revision);
+    return;
+  }
+
+  ZeroMem (&UserToken, sizeof(UserToken));
+  ZeroMem (&TidToken, sizeof(TidToken));
+  gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &UserToken.Event);
+  gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &TidToken.Event);
+
+  UserSize = MonzaxGetBankSize (MonzaXIo, MonzaXMemoryBankUser);
+  TidSize = MonzaxGetBankSize (MonzaXIo, MonzaXMemoryBankTid);
+
+  Status = MonzaXIo->ReadAsync (
+                       MonzaXIo,
+                       MonzaxGetBankBaseAddress (MonzaXIo, MonzaXMemoryBankUser),
+                       UserBuffer,
+                       UserSize,
+                       &UserToken
+                       );
+  Print (L"ReadAsync User - %r\n", Status);
+  if (!EFI_ERROR (Status)) {
+    Status = MonzaXIo->ReadAsync (
+                         MonzaXIo,
+                         MonzaxGetBankBaseAddress (MonzaXIo, MonzaXMemoryBankTid),
+                         TidBuffer,
+                         TidSize,
+                         &TidToken
+                         );
+    Print (L"ReadAsync TID - %r\n", Status);
+    if (EFI_ERROR (Status)) {
+      gBS->WaitForEvent (1, &UserToken.Event, &Index);
+    } else {
+      //
+      // The requests complete in order, so the TID read is the last one.
+      //
+      Events[0] = UserToken.Event;
+      Events[1] = TidToken.Event;
+      gBS->WaitForEvent (1, &Events[0], &Index);
+      gBS->WaitForEvent (1, &Events[1], &Index);
+
+      Print (L"TID - %r\n", TidToken.TransactionStatus);
+      CheckResult (TidToken.DataLength, TidSize);
+      InternalDumpHex (TidBuffer, TidToken.DataLength);
+    }
+    Print (L"User - %r\n", UserToken.TransactionStatus);
+    CheckResult (UserToken.DataLength, UserSize);
+    InternalDumpHex (UserBuffer, UserToken.DataLength);
+  }
+
+  gBS->CloseEvent (UserToken.Event);
+  gBS->CloseEvent (TidToken.Event);
+}
+
+/**
+  Get the trace protocol installed with a MonzaX IO instance.
+
+  @param MonzaXIo   MonzaX IO instance
+
+  @return The trace protocol, or NULL if the driver does not produce one.
+**/
+MONZAX_TRACE_PROTOCOL *
+GetMonzaXTrace (
+  IN MONZAX_IO_PROTOCOL *MonzaXIo
+  )
+{
+  EFI_STATUS             Status;
+  EFI_HANDLE             *Handles;
+  UINTN                  HandleCount;
+  UINTN                  Index;
+  MONZAX_IO_PROTOCOL     *Io;
+  MONZAX_TRACE_PROTOCOL  *Trace;
+
+  Trace = NULL;
+  Status = gBS->LocateHandleBuffer (ByProtocol, &gMonzaXTraceProtocolGuid, NULL, &HandleCount, &Handles);
+  if (EFI_ERROR (Status)) {
+    return NULL;
+  }
+  for (Index = 0; Index < HandleCount; Index++) {
+    Status = gBS->HandleProtocol (Handles[Index], &gMonzaXIoProtocolGuid, (VOID **)&Io);
+    if (!EFI_ERROR (Status) && (Io == MonzaXIo)) {
+      gBS->HandleProtocol (Handles[Index], &gMonzaXTraceProtocolGuid, (VOID **)&Trace);
+      break;
+    }
+  }
+  FreePool (Handles);
+  return Trace;
+}
+
+#define TRACE_DUMP_ENTRIES  256
+
+CHAR16 *mTraceOpCodeName[] = {
+  L"Read",
+  L"Write",
+  L"ReportOut",
+  L"ReportIn",
+  L"MuxSelect"
+};
+
+/**
+  Dump the transfer trace of the MonzaX device, oldest first.
+
+  @param MonzaXIo   MonzaX IO instance
+**/
+VOID
+MonzaXDumpTrace (
+  IN MONZAX_IO_PROTOCOL *MonzaXIo
+  )
+{
+  EFI_STATUS             Status;
+  MONZAX_TRACE_PROTOCOL  *Trace;
+  MONZAX_TRACE_ENTRY     *Entries;
+  UINTN                  EntryCount;
+  UINTN                  Index;
+
+  Trace = GetMonzaXTrace (MonzaXIo);
+  if (Trace == NULL) {
+    Print (L"MonzaXTrace - %r\n", EFI_NOT_FOUND);
+    return;
+  }
+
+  Entries = AllocatePool (TRACE_DUMP_ENTRIES * sizeof(MONZAX_TRACE_ENTRY));
+  if (Entries == NULL) {
+    return;
+  }
+
+  EntryCount = TRACE_DUMP_ENTRIES;
+  Status = Trace->GetEntries (Trace, &EntryCount, Entries);
+  Print (L"GetEntries - %r, %d entries\n", Status, EntryCount);
+  if (!EFI_ERROR (Status)) {
+    Print (L"       Time (ns)  Op         Slave  Addr    Len  Latency (us)  Status\n");
+    for (Index = 0; Index < EntryCount; Index++) {
+      Print (
+        L"%16ld  %-9s  0x%02x   0x%04x  %4d  %12d  %r\n",
+        Entries[Index].Timestamp,
+        (Entries[Index].OpCode < sizeof(mTraceOpCodeName)/sizeof(mTraceOpCodeName[0])) ? mTraceOpCodeName[Entries[Index].OpCode] : L"?",
+        Entries[Index].Slave,
+        Entries[Index].Address,
+        Entries[Index].Length,
+        Entries[Index].Latency,
+        Entries[Index].Status
+        );
+    }
+  }
+
+  FreePool (Entries);
+}
+
+/**
+  Clear the transfer trace of the MonzaX device.
+
+  @param MonzaXIo   MonzaX IO instance
+**/
+VOID
+MonzaXClearTrace (
+  IN MONZAX_IO_PROTOCOL *MonzaXIo
+  )
+{
+  MONZAX_TRACE_PROTOCOL  *Trace;
+
+  Trace = GetMonzaXTrace (MonzaXIo);
+  if (Trace == NULL) {
+    Print (L"MonzaXTrace - %r\n", EFI_NOT_FOUND);
+    return;
+  }
+  Print (L"Clear - %r\n", Trace->Clear (Trace));
+}
+
+/**
+  Wait up to 10 seconds for an edge of the wake GPIO of the MonzaX device.
+
+  @param MonzaXIo   MonzaX IO instance
+**/
+VOID
+MonzaXWaitWake (
+  IN MONZAX_IO_PROTOCOL *MonzaXIo
+  )
+{
+  EFI_STATUS              Status;
+  EFI_HANDLE              *Handles;
+  UINTN                   HandleCount;
+  UINTN                   Index;
+  MONZAX_IO_PROTOCOL      *Io;
+  MONZAX_NOTIFY_PROTOCOL  *Notify;
+  EFI_EVENT               Events[2];
+  BOOLEAN                 Level;
+  UINT32                  EdgeCount;
+
+  Notify = NULL;
+  Status = gBS->LocateHandleBuffer (ByProtocol, &gMonzaXNotifyProtocolGuid, NULL, &HandleCount, &Handles);
+  if (!EFI_ERROR (Status)) {
+    for (Index = 0; Index < HandleCount; Index++) {
+      Status = gBS->HandleProtocol (Handles[Index], &gMonzaXIoProtocolGuid, (VOID **)&Io);
+      if (!EFI_ERROR (Status) && (Io == MonzaXIo)) {
+        gBS->HandleProtocol (Handles[Index], &gMonzaXNotifyProtocolGuid, (VOID **)&Notify);
+        break;
+      }
+    }
+    FreePool (Handles);
+  }
+  if (Notify == NULL) {
+    Print (L"MonzaXNotify - %r\n", EFI_NOT_FOUND);
+    return;
+  }
+
+  Status = gBS->CreateEvent (0, 0, NULL, NULL, &Events[0]);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+  Status = gBS->CreateEvent (EVT_TIMER, 0, NULL, NULL, &Events[1]);
+  if (EFI_ERROR (Status)) {
+    gBS->CloseEvent (Events[0]);
+    return;
+  }
+
+  Status = Notify->Register (Notify, Events[0]);
+  Print (L"Register - %r\n", Status);
+  if (!EFI_ERROR (Status)) {
+    gBS->SetTimer (Events[1], TimerRelative, EFI_TIMER_PERIOD_SECONDS (10));
+    gBS->WaitForEvent (2, Events, &Index);
+    Notify->GetState (Notify, &Level, &EdgeCount);
+    Print (L"%s - level %d, %d edges\n", (Index == 0) ? L"Wake" : L"Timeout", Level, EdgeCount);
+    Notify->Unregister (Notify, Events[0]);
+  }
+
+  gBS->CloseEvent (Events[1]);
+  gBS->CloseEvent (Events[0]);
+}
+
+/**
+  Print the non-empty buckets of a histogram.
+
+  @param Name        Name of the histogram
+  @param Histogram   The buckets
+  @param BucketCount The number of buckets
+**/
+VOID
+DumpHistogram (
+  IN CHAR16   *Name,
+  IN UINT32   *Histogram,
+  IN UINTN    BucketCount
+  )
+{
+  UINTN       Index;
+
+  Print (L"%s:\n", Name);
+  for (Index = 0; Index < BucketCount; Index++) {
+    if (Histogram[Index] == 0) {
+      continue;
+    }
+    if (Index == 0) {
+      Print (L"  < 1       %d\n", Histogram[Index]);
+    } else if (Index == BucketCount - 1) {
+      Print (L"  >= %-6d %d\n", 1 << (Index - 1), Histogram[Index]);
+    } else {
+      Print (L"  %6d+   %d\n", 1 << (Index - 1), Histogram[Index]);
+    }
+  }
+}
+
+/**
+  Dump the bus statistics of the MonzaX device.
+
+  @param MonzaXIo   MonzaX IO instance
+**/
+VOID
+MonzaXDumpStatistics (
+  IN MONZAX_IO_PROTOCOL *MonzaXIo
+  )
+{
+  EFI_STATUS                  Status;
+  EFI_HANDLE                  *Handles;
+  UINTN                       HandleCount;
+  UINTN                       Index;
+  MONZAX_IO_PROTOCOL          *Io;
+  MONZAX_STATISTICS_PROTOCOL  *StatisticsProtocol;
+  MONZAX_STATISTICS           Statistics;
+
+  StatisticsProtocol = NULL;
+  Status = gBS->LocateHandleBuffer (ByProtocol, &gMonzaXStatisticsProtocolGuid, NULL, &HandleCount, &Handles);
+  if (!EFI_ERROR (Status)) {
+    for (Index = 0; Index < HandleCount; Index++) {
+      Status = gBS->HandleProtocol (Handles[Index], &gMonzaXIoProtocolGuid, (VOID **)&Io);
+      if (!EFI_ERROR (Status) && (Io == MonzaXIo)) {
+        gBS->HandleProtocol (Handles[Index], &gMonzaXStatisticsProtocolGuid, (VOID **)&StatisticsProtocol);
+        break;
+      }
+    }
+    FreePool (Handles);
+  }
+  if (StatisticsProtocol == NULL) {
+    Print (L"MonzaXStatistics - %r\n", EFI_NOT_FOUND);
+    return;
+  }
+
+  Status = StatisticsProtocol->Get (StatisticsProtocol, &Statistics);
+  Print (L"Get - %r\n", Status);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+  Print (L"Status idle/busy/complete/error - %d/%d/%d/%d\n", Statistics.StatusIdle, Statistics.StatusBusy, Statistics.StatusComplete, Statistics.StatusError);
+  Print (L"Busy, address NACKed - %d\n", Statistics.BusyAddressNacked);
+  Print (L"Error, address NACKed - %d\n", Statistics.ErrorAddressNacked);
+  Print (L"Error, bus not free - %d\n", Statistics.ErrorBusNotFree);
+  Print (L"Error, arbitration lost - %d\n", Statistics.ErrorArbitrationLost);
+  Print (L"Error, read/write incomplete - %d/%d\n", Statistics.ErrorReadIncomplete, Statistics.ErrorWriteIncomplete);
+  Print (L"Retries - %d\n", Statistics.Retries);
+  DumpHistogram (L"Retries per transfer", Statistics.RetryHistogram, MONZAX_STATISTICS_RETRY_BUCKETS);
+  DumpHistogram (L"Read latency (us)", Statistics.ReadLatencyHistogram, MONZAX_STATISTICS_LATENCY_BUCKETS);
+  DumpHistogram (L"Write latency (us)", Statistics.WriteLatencyHistogram, MONZAX_STATISTICS_LATENCY_BUCKETS);
+}
+
+#define SCHEDULER_MAX_DEVICES  16
+#define SCHEDULER_WRITE_LENGTH (3 * MONZAX_SIZE_BYTES_WRITE_PAGE)
+
+/**
+  Read the TID of every device of the USB driver, write a few pages of user
+  memory and read them back, all in one scheduler run. Each device gets its
+  own pattern, and its queue runs in order, so the read back must match.
+**/
+VOID
+MonzaXScheduledReadTid (
+  VOID
+  )
+{
+  EFI_STATUS                 Status;
+  MONZAX_SCHEDULER_PROTOCOL  *Scheduler;
+  MONZAX_IO_PROTOCOL         *Devices[SCHEDULER_MAX_DEVICES];
+  MONZAX_IO_TOKEN            Tokens[SCHEDULER_MAX_DEVICES];
+  MONZAX_IO_TOKEN            WriteTokens[SCHEDULER_MAX_DEVICES];
+  MONZAX_IO_TOKEN            ReadTokens[SCHEDULER_MAX_DEVICES];
+  UINT8                      Tid[SCHEDULER_MAX_DEVICES][MONZAX_SIZE_BYTES_TID];
+  UINT8                      WriteData[SCHEDULER_MAX_DEVICES][SCHEDULER_WRITE_LENGTH];
+  UINT8                      ReadData[SCHEDULER_MAX_DEVICES][SCHEDULER_WRITE_LENGTH];
+  UINT16                     UserAddress;
+  UINTN                      DeviceCount;
+  UINTN                      Index;
+  UINTN                      Offset;
+
+  Status = gBS->LocateProtocol (&gMonzaXSchedulerProtocolGuid, NULL, (VOID **)&Scheduler);
+  if (EFI_ERROR (Status)) {
+    Print (L"MonzaXScheduler - %r\n", Status);
+    return;
+  }
+
+  DeviceCount = SCHEDULER_MAX_DEVICES;
+  Status = Scheduler->GetDevices (Scheduler, &DeviceCount, Devices);
+  Print (L"GetDevices - %r, %d devices\n", Status, DeviceCount);
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  ZeroMem (Tokens, sizeof(Tokens));
+  ZeroMem (WriteTokens, sizeof(WriteTokens));
+  ZeroMem (ReadTokens, sizeof(ReadTokens));
+  ZeroMem (ReadData, sizeof(ReadData));
+  for (Index = 0; Index < DeviceCount; Index++) {
+    gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Tokens[Index].Event);
+    Status = Scheduler->Submit (
+                          Scheduler,
+                          Devices[Index],
+                          FALSE,
+                          MonzaxGetBankBaseAddress (Devices[Index], MonzaXMemoryBankTid),
+                          Tid[Index],
+                          MONZAX_SIZE_BYTES_TID,
+                          &Tokens[Index]
+                          );
+    if (EFI_ERROR (Status)) {
+      Tokens[Index].TransactionStatus = Status;
+    }
+
+    for (Offset = 0; Offset < SCHEDULER_WRITE_LENGTH; Offset++) {
+      WriteData[Index][Offset] = (UINT8)((Index << 4) + Offset);
+    }
+    UserAddress = MonzaxGetBankBaseAddress (Devices[Index], MonzaXMemoryBankUser);
+
+    gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &WriteTokens[Index].Event);
+    Status = Scheduler->Submit (
+                          Scheduler,
+                          Devices[Index],
+                          TRUE,
+                          UserAddress,
+                          WriteData[Index],
+                          SCHEDULER_WRITE_LENGTH,
+                          &WriteTokens[Index]
+                          );
+    if (EFI_ERROR (Status)) {
+      WriteTokens[Index].TransactionStatus = Status;
+    }
+
+    gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &ReadTokens[Index].Event);
+    Status = Scheduler->Submit (
+                          Scheduler,
+                          Devices[Index],
+                          FALSE,
+                          UserAddress,
+                          ReadData[Index],
+                          SCHEDULER_WRITE_LENGTH,
+                          &ReadTokens[Index]
+                          );
+    if (EFI_ERROR (Status)) {
+      ReadTokens[Index].TransactionStatus = Status;
+    }
+  }
+
+  Print (L"Run - %r\n", Scheduler->Run (Scheduler));
+
+  for (Index = 0; Index < DeviceCount; Index++) {
+    Print (L"Device %d TID - %r\n", Index, Tokens[Index].TransactionStatus);
+    if (!EFI_ERROR (Tokens[Index].TransactionStatus)) {
+      InternalDumpHex (Tid[Index], Tokens[Index].DataLength);
+    }
+    Print (L"Device %d write - %r\n", Index, WriteTokens[Index].TransactionStatus);
+    Print (L"Device %d read back - %r\n", Index, ReadTokens[Index].TransactionStatus);
+    if (!EFI_ERROR (WriteTokens[Index].TransactionStatus) && !EFI_ERROR (ReadTokens[Index].TransactionStatus)) {
+      CheckResult (WriteTokens[Index].DataLength, SCHEDULER_WRITE_LENGTH);
+      CheckResult (ReadTokens[Index].DataLength, SCHEDULER_WRITE_LENGTH);
+      if (CompareMem (ReadData[Index], WriteData[Index], SCHEDULER_WRITE_LENGTH) != 0) {
+        Print (L"Device %d read back does not match the data written\n", Index);
+        InternalDumpHex (ReadData[Index], ReadTokens[Index].DataLength);
+      }
+    }
+    gBS->CloseEvent (ReadTokens[Index].Event);
+    gBS->CloseEvent (WriteTokens[Index].Event);
+    gBS->CloseEvent (Tokens[Index].Event);
+  }
+}
+
 /**
   Run APP test.
 
@@ -581,6 +1064,24 @@ MonzaXAppTest (
     Count = MonzaxDisableWriteWakeupMode (MonzaXIo);
     CheckResult (Count, 1);
     break;
+  case 36:
+    MonzaXAsyncDumpMemory (MonzaXIo);
+    break;
+  case 37:
+    MonzaXDumpTrace (MonzaXIo);
+    break;
+  case 38:
+    MonzaXClearTrace (MonzaXIo);
+    break;
+  case 39:
+    MonzaXWaitWake (MonzaXIo);
+    break;
+  case 40:
+    MonzaXScheduledReadTid ();
+    break;
+  case 41:
+    MonzaXDumpStatistics (MonzaXIo);
+    break;
   case 99:
     break;
   default:
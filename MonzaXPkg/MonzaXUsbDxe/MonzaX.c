@@ -24,644 +24,1885 @@ SOFTWARE.
 
 #include "MonzaXDxe.h"
 
-#define DUMP_ASCII
+/**
+
+  Get the time elapsed since a performance counter value.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Start      The performance counter at the start.
+
+  @return The time elapsed, in us.
+
+**/
+UINT64
+GetElapsedTime (
+  IN MONZAX_DEV           *Dev,
+  IN UINT64               Start
+  )
+{
+  return DivU64x32 (GetTimeInNanoSecond (MonzaxGetElapsedTicks (&Dev->Trace, Start, GetPerformanceCounter ())), 1000);
+}
 
 /**
 
-  This function dump raw data.
+  Get the time the SMBus takes to move bytes at the configured clock.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param ByteCount  The number of bytes.
 
-  @param  Data  raw data
-  @param  Size  raw data size
+  @return The time, in us, at 9 clocks a byte.
 
 **/
-VOID
-InternalDumpData (
-  IN UINT8  *Data,
-  IN UINTN  Size
+UINT32
+GetBusTime (
+  IN MONZAX_DEV           *Dev,
+  IN UINTN                ByteCount
   )
 {
-  UINTN  Index;
-  for (Index = 0; Index < Size; Index++) {
-    DEBUG ((EFI_D_INFO, "%02x ", (UINTN)Data[Index]));
+  UINT32               Clock;
+
+  Clock = SwapBytes32 (Dev->SmbusConfig.ClockSpeed);
+  if (Clock == 0) {
+    Clock = MONZAX_SMBUS_CLOCK_DEFAULT;
   }
+  return (UINT32) DivU64x32 (MultU64x32 ((UINT64) ByteCount * 9, 1000000), Clock);
 }
 
 /**
 
-  Return if char is printable.
+  Get the timeout of a report transfer.
 
-  @param Ch A Character
+  Until the first input report is seen the latency is unknown and the
+  longest timeout is used.
 
-  @retval TRUE  If the char is printable.
-  @retval FALSE If the char is not printable.
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param BusBytes   The bytes the bridge may move on the SMBus meanwhile.
+
+  @return The timeout, in ms.
 
 **/
-STATIC
-BOOLEAN
-IsPrintable (
-  IN UINT8 Ch
+UINTN
+GetReportTimeout (
+  IN MONZAX_DEV           *Dev,
+  IN UINTN                BusBytes
   )
 {
-  if ((Ch <= 0x20) || (Ch >= 0x7F)) {
-    return FALSE;
-  } else {
-    return TRUE;
+  UINT64               Timeout;
+
+  if (Dev->ReportLatency == 0) {
+    return MONZAX_REPORT_TIMEOUT_MAX;
   }
+
+  Timeout = (UINT64) Dev->ReportLatency + 4 * (UINT64) Dev->ReportLatencyDeviation + GetBusTime (Dev, BusBytes);
+  Timeout = DivU64x32 (Timeout + 999, 1000);
+  if (Timeout < MONZAX_REPORT_TIMEOUT_MIN) {
+    return MONZAX_REPORT_TIMEOUT_MIN;
+  }
+  if (Timeout > MONZAX_REPORT_TIMEOUT_MAX) {
+    return MONZAX_REPORT_TIMEOUT_MAX;
+  }
+  return (UINTN) Timeout;
 }
 
 /**
 
-  This function dump raw data with colume format.
+  Fold the latency of an input report into the smoothed report latency,
+  with gains of 1/8 for the mean and 1/4 for the deviation.
 
-  @param  Data  raw data
-  @param  Size  raw data size
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Latency    The latency of the report, in us.
+  @param BusBytes   The bytes the bridge moved on the SMBus meanwhile.
 
 **/
 VOID
-InternalDumpHex (
-  IN UINT8  *Data,
-  IN UINTN  Size
+UpdateReportLatency (
+  IN MONZAX_DEV           *Dev,
+  IN UINT64               Latency,
+  IN UINTN                BusBytes
   )
 {
-  UINTN   Index;
-  UINTN   Count;
-  UINTN   Left;
-#ifdef DUMP_ASCII
-  UINTN   Index2;
-#endif
+  UINT32               Sample;
+  UINT32               Deviation;
 
-#define COLUME_SIZE  (16)
+  Sample = (UINT32) MIN (Latency, MONZAX_REPORT_TIMEOUT_MAX * 1000);
+  Sample = Sample - MIN (Sample, GetBusTime (Dev, BusBytes));
+  Sample = MAX (Sample, 1);
 
-  Count = Size / COLUME_SIZE;
-  Left  = Size % COLUME_SIZE;
-  for (Index = 0; Index < Count; Index++) {
-//    DEBUG ((EFI_D_INFO, "%04x: ", Index * COLUME_SIZE));
-    InternalDumpData (Data + Index * COLUME_SIZE, COLUME_SIZE);
-#ifdef DUMP_ASCII
-    DEBUG ((EFI_D_INFO, "        '"));
-    for ( Index2 = 0; Index2 < COLUME_SIZE; Index2++ ) {
-      DEBUG ((EFI_D_INFO, "%c", IsPrintable((Data + Index * COLUME_SIZE)[Index2]) ? (Data + Index * COLUME_SIZE)[Index2] : '.'));
-    }
-    DEBUG ((EFI_D_INFO, "'"));
-#endif
-    DEBUG ((EFI_D_INFO, "\n"));
+  if (Dev->ReportLatency == 0) {
+    Dev->ReportLatency = Sample;
+    Dev->ReportLatencyDeviation = Sample / 2;
+    return;
   }
 
-  if (Left != 0) {
-//    DEBUG ((EFI_D_INFO, "%04x: ", Index * COLUME_SIZE));
-    InternalDumpData (Data + Index * COLUME_SIZE, Left);
-#ifdef DUMP_ASCII
-    for ( Index2 = 0; Index2 < COLUME_SIZE - Left; Index2++ ) {
-      DEBUG ((EFI_D_INFO, "   "));
-    }
-    DEBUG ((EFI_D_INFO, "        '"));
-    for ( Index2 = 0; Index2 < Left; Index2++ ) {
-      DEBUG ((EFI_D_INFO, "%c", IsPrintable((Data + Index * COLUME_SIZE)[Index2]) ? (Data + Index * COLUME_SIZE)[Index2] : '.'));
-    }
-    DEBUG ((EFI_D_INFO, "'"));
-#endif
-    DEBUG ((EFI_D_INFO, "\n"));
+  Deviation = (Sample > Dev->ReportLatency) ? (Sample - Dev->ReportLatency) : (Dev->ReportLatency - Sample);
+  Dev->ReportLatencyDeviation = Dev->ReportLatencyDeviation - Dev->ReportLatencyDeviation / 4 + Deviation / 4;
+  Dev->ReportLatency = MAX (Dev->ReportLatency - Dev->ReportLatency / 8 + Sample / 8, 1);
+}
+
+/**
+
+  Get the time left of an operation budget.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Start      The performance counter at the start of the operation.
+  @param Budget     The budget of the operation, in us.
+
+  @return The time left, in ms, 0 once the budget is spent.
+
+**/
+UINTN
+GetTimeLeft (
+  IN MONZAX_DEV           *Dev,
+  IN UINT64               Start,
+  IN UINT64               Budget
+  )
+{
+  UINT64               Elapsed;
+
+  Elapsed = GetElapsedTime (Dev, Start);
+  if (Elapsed >= Budget) {
+    return 0;
   }
+  return (UINTN) DivU64x32 (Budget - Elapsed + 999, 1000);
 }
 
 /**
 
-  Check command before read/write a unit from/to an I2C device. 
+  Get the budget of an operation: PcdMonzaXUsbTransferBudget plus the
+  SMBus time of the bytes it moves.
 
   @param Dev        Pointer to the MONZAX_DEV instance.
-  
-  @return device status.
+  @param BusBytes   The bytes the operation moves on the SMBus.
+
+  @return The budget, in us.
+
+**/
+UINT64
+GetOperationBudget (
+  IN MONZAX_DEV           *Dev,
+  IN UINTN                BusBytes
+  )
+{
+  return MultU64x32 (PcdGet32 (PcdMonzaXUsbTransferBudget), 1000) + GetBusTime (Dev, BusBytes);
+}
+
+/**
+
+  Send an output report to the CP2112 interrupt OUT endpoint.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Report     The report to send.
+  @param ReportLen  The length of the report in bytes.
+
+  @retval EFI_SUCCESS       The report is sent.
+  @retval EFI_DEVICE_ERROR  The report cannot be sent.
 
 **/
 EFI_STATUS
-CheckCommand (
-  IN MONZAX_DEV           *Dev
+UsbSendReport (
+  IN MONZAX_DEV           *Dev,
+  IN VOID                 *Report,
+  IN UINTN                ReportLen
   )
 {
-  EFI_USB_IO_PROTOCOL  *UsbIo;
   EFI_STATUS           Status;
   UINT32               UsbStatus;
-  UINTN                DataLength;
-  UINTN                CheckCount;
+  UINT64               TraceStart;
+
+  Dev->InterruptTransferCount++;
+  TraceStart = MONZAX_TRACE_BEGIN ();
+  //
+  // The bridge may hold the report until it is done with the longest
+  // transfer it can have in progress.
+  //
+  Status = Dev->UsbIo->UsbSyncInterruptTransfer (
+                         Dev->UsbIo,
+                         Dev->OutEndpointDescriptor.EndpointAddress,
+                         Report,
+                         &ReportLen,
+                         GetReportTimeout (Dev, CP2112_DATA_READ_MAX_LENGTH),
+                         &UsbStatus
+                         );
+  if (!EFI_ERROR (Status) && (UsbStatus != EFI_USB_NOERROR)) {
+    Status = EFI_DEVICE_ERROR;
+  }
+  MONZAX_TRACE (Dev, MonzaXTraceReportOut, 0, *(UINT8 *)Report, ReportLen, Status, TraceStart);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "UsbSendReport - 0x%02x - Status %r, UsbStatus - 0x%08x\n", *(UINT8 *)Report, Status, UsbStatus));
+    return EFI_DEVICE_ERROR;
+  }
+  return EFI_SUCCESS;
+}
 
-  CP2112_TRANSFER_STATUS_REQUEST_STRUCT  CommandCheck;
-  CP2112_TRANSFER_STATUS_RESPONSE_STRUCT ReponseCheck;
-  UINT8                            Buffer[0x40];
+/**
 
-  DEBUG ((EFI_D_INFO, "CheckCommand - 0x%02x\n", Dev->OutEndpointDescriptor.EndpointAddress));
+  Callback of the asynchronous interrupt IN transfer.
 
-  UsbIo = Dev->UsbIo;
+  It queues the received report into the receive ring of the device.
 
-  CheckCount = 0;
+  @param Data           The report received.
+  @param DataLength     The length of the report in bytes.
+  @param Context        Pointer to the MONZAX_DEV instance.
+  @param Result         The USB transfer result.
 
-ContinueCheck:
-  if (CheckCount > 10) {
+  @retval EFI_SUCCESS       The report is queued.
+  @retval EFI_DEVICE_ERROR  The transfer failed or the ring is full.
+
+**/
+EFI_STATUS
+EFIAPI
+AsyncReceiveCallback (
+  IN VOID                 *Data,
+  IN UINTN                DataLength,
+  IN VOID                 *Context,
+  IN UINT32               Result
+  )
+{
+  MONZAX_DEV           *Dev;
+  MONZAX_REPORT        *Report;
+  UINTN                Head;
+  UINT32               UsbStatus;
+
+  Dev = (MONZAX_DEV *)Context;
+
+  if (Result != EFI_USB_NOERROR) {
+    DEBUG ((EFI_D_ERROR, "AsyncReceiveCallback - UsbStatus - 0x%08x\n", Result));
+    //
+    // The host controller does not run the transfer again after an error.
+    // Clear the halt, cancel the transfer and resubmit it a bit later, as
+    // the USB keyboard driver does.
+    //
+    if ((Result & EFI_USB_ERR_STALL) == EFI_USB_ERR_STALL) {
+      UsbClearEndpointHalt (Dev->UsbIo, Dev->InEndpointDescriptor.EndpointAddress, &UsbStatus);
+    }
+    Dev->UsbIo->UsbAsyncInterruptTransfer (
+                  Dev->UsbIo,
+                  Dev->InEndpointDescriptor.EndpointAddress,
+                  FALSE,
+                  0,
+                  0,
+                  NULL,
+                  NULL
+                  );
+    gBS->SetTimer (Dev->ReceiveRecoveryEvent, TimerRelative, MONZAX_RECEIVE_RECOVERY_DELAY);
     return EFI_DEVICE_ERROR;
   }
-  ZeroMem (&CommandCheck, sizeof(CommandCheck));
-  CommandCheck.Command = CP2112_TRANSFER_STATUS_REQUEST;
-  CommandCheck.Request = CP2112_TRANSFER_STATUS_REQUEST_SMBUS_TRANSFER_STATUS;
-  DataLength = sizeof(CommandCheck);
-  Status = UsbIo->UsbSyncInterruptTransfer (
-                    UsbIo,
-                    Dev->OutEndpointDescriptor.EndpointAddress,
-                    &CommandCheck,
-                    &DataLength,
-                    3 * 1000,
-                    &UsbStatus
-                    );
-  DEBUG ((EFI_D_INFO, "CheckCommand - CommandCheck - Status %r, UsbStatus - 0x%08x\n", Status, UsbStatus));
-  InternalDumpHex ((UINT8 *)&CommandCheck, DataLength);
-  if (EFI_ERROR (Status) || (UsbStatus != EFI_USB_NOERROR)) {
-    return EFI_DEVICE_ERROR;
+
+  if ((Data == NULL) || (DataLength == 0)) {
+    return EFI_SUCCESS;
   }
 
-  DataLength = sizeof(Buffer);
-  Status = UsbIo->UsbSyncInterruptTransfer (
-                    UsbIo,
-                    Dev->InEndpointDescriptor.EndpointAddress,
-                    &Buffer,
-                    &DataLength,
-                    3 * 1000,
-                    &UsbStatus
-                    );
-  DEBUG ((EFI_D_INFO, "CheckCommand - ReadData - Status %r, UsbStatus - 0x%08x\n", Status, UsbStatus));
-  if (EFI_ERROR (Status) || (UsbStatus != EFI_USB_NOERROR)) {
+  Head = Dev->ReceiveHead;
+  if (Head - Dev->ReceiveTail >= MONZAX_RECEIVE_RING_SIZE) {
+    //
+    // Nobody consumes the reports, drop the new one.
+    //
+    Dev->ReceiveOverflowCount++;
     return EFI_DEVICE_ERROR;
   }
-  CopyMem (&ReponseCheck, Buffer, sizeof(ReponseCheck));
-  InternalDumpHex ((UINT8 *)&ReponseCheck, DataLength);
 
-  if ((ReponseCheck.Command != CP2112_TRANSFER_STATUS_RESPONSE) ||
-      (ReponseCheck.Status0 != CP2112_TRANSFER_STATUS_RESPONSE_STATUS0_IDLE)) {
-    CheckCount++;
-    goto ContinueCheck;
-  }
+  Report = &Dev->ReceiveRing[Head % MONZAX_RECEIVE_RING_SIZE];
+  Report->Length = MIN (DataLength, sizeof(Report->Data));
+  CopyMem (Report->Data, Data, Report->Length);
+  Dev->ReceiveHead = Head + 1;
 
   return EFI_SUCCESS;
 }
 
 /**
 
-  Read a unit from an I2C device.
-  
-  @param Dev        Pointer to the MONZAX_DEV instance.
-  @param Address    The memory address to start reading from.
-  @param AddressLen The length of the address in bytes (1 or 2).
-  @param Data       A buffer of bytes to hold the data.
-  @param DataLen    The number of bytes to read.
+  Timer notification that resubmits the asynchronous interrupt IN transfer
+  after an error. If it cannot be resubmitted, receives go back to
+  synchronous interrupt transfers.
 
-  @return  The number of bytes read.
+  @param Event      The recovery timer event.
+  @param Context    Pointer to the MONZAX_DEV instance.
 
 **/
-UINTN
-I2cReadUnit (
-  IN MONZAX_DEV           *Dev,
-  IN UINT16               Address,
-  IN UINT8                AddressLen,
-  OUT UINT8               *Data,
-  IN UINTN                DataLen
+VOID
+EFIAPI
+AsyncReceiveRecovery (
+  IN EFI_EVENT            Event,
+  IN VOID                 *Context
   )
 {
-  EFI_USB_IO_PROTOCOL  *UsbIo;
   EFI_STATUS           Status;
-  UINT32               UsbStatus;
-  UINTN                DataLength;
-  UINTN                CheckCount;
+  MONZAX_DEV           *Dev;
 
-  CP2112_DATA_WRITE_READ_REQUEST_STRUCT  DataWriteRead;
-  CP2112_DATA_READ_FORCE_SEND_STRUCT     DataReadForce;
-  CP2112_DATA_READ_RESPONSE_STRUCT       *ReadResponse;
-  UINTN                                  ReadDataLen;
+  Dev = (MONZAX_DEV *)Context;
+  Status = Dev->UsbIo->UsbAsyncInterruptTransfer (
+                         Dev->UsbIo,
+                         Dev->InEndpointDescriptor.EndpointAddress,
+                         TRUE,
+                         Dev->InEndpointDescriptor.Interval,
+                         Dev->InEndpointDescriptor.MaxPacketSize,
+                         AsyncReceiveCallback,
+                         Dev
+                         );
+  DEBUG ((EFI_D_INFO, "AsyncReceiveRecovery - %r\n", Status));
+  if (EFI_ERROR (Status)) {
+    Dev->AsyncReceive = FALSE;
+  }
+}
 
-  UINT8                Buffer[0x40];
+/**
 
-  DEBUG ((EFI_D_INFO, "I2cRead(Usb) - Addr (0x%x), Size (0x%x)\n", Address, DataLen));
+  Start the asynchronous interrupt IN transfer that feeds the receive ring.
 
-  UsbIo = Dev->UsbIo;
-  
-  CheckCount = 0;
+  @param Dev        Pointer to the MONZAX_DEV instance.
 
-  ReadDataLen = 0;
+  @return the status of UsbAsyncInterruptTransfer.
 
-  Status = CheckCommand (Dev);
+**/
+EFI_STATUS
+StartAsyncReceive (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  EFI_STATUS           Status;
+
+  Dev->ReceiveHead = 0;
+  Dev->ReceiveTail = 0;
+  Dev->ReceiveOverflowCount = 0;
+
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_NOTIFY,
+                  AsyncReceiveRecovery,
+                  Dev,
+                  &Dev->ReceiveRecoveryEvent
+                  );
   if (EFI_ERROR (Status)) {
-    DEBUG ((EFI_D_ERROR, "I2cRead(Usb) - Check Command fail\n"));
-    return 0;
+    Dev->AsyncReceive = FALSE;
+    return Status;
   }
 
-  DataWriteRead.Command = CP2112_DATA_WRITE_READ_REQUEST;
-  DataWriteRead.SlaveAddress = Dev->MonzaxI2cDeviceId << 1;
-  DataWriteRead.Length = SwapBytes16 ((UINT16)DataLen);
-  DataWriteRead.TargetAddressLength = AddressLen;
-  if (AddressLen == 1) {
-    DataWriteRead.TargetAddress[0] = (UINT8)Address;
-  } else {
-    DataWriteRead.TargetAddress[0] = (UINT8)(Address >> 8);
-    DataWriteRead.TargetAddress[1] = (UINT8)Address;
-  }
-  DataLength = sizeof(DataWriteRead) - sizeof(DataWriteRead.TargetAddress) + AddressLen;
-
-  DEBUG ((EFI_D_INFO, "I2cRead - DataWriteRead - 0x%02x\n", Dev->OutEndpointDescriptor.EndpointAddress));
-  Status = UsbIo->UsbSyncInterruptTransfer (
-                    UsbIo,
-                    Dev->OutEndpointDescriptor.EndpointAddress,
-                    &DataWriteRead,
-                    &DataLength,
-                    3 * 1000,
-                    &UsbStatus
-                    );
-  DEBUG ((EFI_D_INFO, "I2cRead - DataWriteRead - Status %r, UsbStatus - 0x%08x\n", Status, UsbStatus));
-  InternalDumpHex ((UINT8 *)&DataWriteRead, DataLength);
-  if (EFI_ERROR (Status) || (UsbStatus != EFI_USB_NOERROR)) {
-    return ReadDataLen;
+  Status = Dev->UsbIo->UsbAsyncInterruptTransfer (
+                         Dev->UsbIo,
+                         Dev->InEndpointDescriptor.EndpointAddress,
+                         TRUE,
+                         Dev->InEndpointDescriptor.Interval,
+                         Dev->InEndpointDescriptor.MaxPacketSize,
+                         AsyncReceiveCallback,
+                         Dev
+                         );
+  DEBUG ((EFI_D_INFO, "StartAsyncReceive - %r\n", Status));
+  Dev->AsyncReceive = !EFI_ERROR (Status);
+  if (EFI_ERROR (Status)) {
+    gBS->CloseEvent (Dev->ReceiveRecoveryEvent);
+    Dev->ReceiveRecoveryEvent = NULL;
   }
+  return Status;
+}
 
-  DataReadForce.Command = CP2112_DATA_READ_FORCE_SEND;
-  DataReadForce.Length = SwapBytes16 ((UINT16)DataLen);
-  DataLength = sizeof(DataReadForce);
-  Status = UsbIo->UsbSyncInterruptTransfer (
-                    UsbIo,
-                    Dev->OutEndpointDescriptor.EndpointAddress,
-                    &DataReadForce,
-                    &DataLength,
-                    3 * 1000,
-                    &UsbStatus
-                    );
-  DEBUG ((EFI_D_INFO, "I2cRead - DataReadForce - Status %r, UsbStatus - 0x%08x\n", Status, UsbStatus));
-  InternalDumpHex ((UINT8 *)&DataReadForce, DataLength);
-  if (EFI_ERROR (Status) || (UsbStatus != EFI_USB_NOERROR)) {
-    return ReadDataLen;
-  }
-
-ContinueRead:
-  if (CheckCount > 10) {
-    DEBUG ((EFI_D_ERROR, "I2cRead(Usb) - ContinueRead fail read - 0x%x\n", ReadDataLen));
-    return ReadDataLen;
-  }
-  DataLength = sizeof(Buffer);
-  Status = UsbIo->UsbSyncInterruptTransfer (
-                    UsbIo,
-                    Dev->InEndpointDescriptor.EndpointAddress,
-                    Buffer,
-                    &DataLength,
-                    3 * 1000,
-                    &UsbStatus
-                    );
-  DEBUG ((EFI_D_INFO, "I2cRead - ReadData - Status %r, UsbStatus - 0x%08x\n", Status, UsbStatus));
-  if (EFI_ERROR (Status) || (UsbStatus != EFI_USB_NOERROR)) {
-    return ReadDataLen;
-  }
-
-  InternalDumpHex (Buffer, DataLength);
-
-  ReadResponse = (CP2112_DATA_READ_RESPONSE_STRUCT *)Buffer;
-
-  if (ReadResponse->Command != CP2112_DATA_READ_RESPONSE) {
-    CP2112_TRANSFER_STATUS_REQUEST_STRUCT  CommandCheck;
+/**
 
-    ZeroMem (&CommandCheck, sizeof(CommandCheck));
-    CommandCheck.Command = CP2112_TRANSFER_STATUS_REQUEST;
-    CommandCheck.Request = CP2112_TRANSFER_STATUS_REQUEST_SMBUS_TRANSFER_STATUS;
-    DataLength = sizeof(CommandCheck);
-    Status = UsbIo->UsbSyncInterruptTransfer (
-                      UsbIo,
-                      Dev->OutEndpointDescriptor.EndpointAddress,
-                      &CommandCheck,
-                      &DataLength,
-                      3 * 1000,
-                      &UsbStatus
-                      );
-    DEBUG ((EFI_D_INFO, "CheckCommand - CommandCheck - Status %r, UsbStatus - 0x%08x\n", Status, UsbStatus));
-    InternalDumpHex ((UINT8 *)&CommandCheck, DataLength);
-    if (EFI_ERROR(Status) || (UsbStatus != EFI_USB_NOERROR)) {
-      return ReadDataLen;
-    }
+  Stop the asynchronous interrupt IN transfer that feeds the receive ring,
+  and its recovery.
 
-    CheckCount++;
-    goto ContinueRead;
-  }
+  @param Dev        Pointer to the MONZAX_DEV instance.
 
-  CopyMem (Data + ReadDataLen, ReadResponse + 1, ReadResponse->Length);
-  ReadDataLen += ReadResponse->Length;
-  switch (ReadResponse->Status) {
-  case CP2112_DATA_READ_RESPONSE_STATUS_COMPLETE:
-    return ReadDataLen;
-  case CP2112_DATA_READ_RESPONSE_STATUS_BUSY:
-    goto ContinueRead;
-  case CP2112_DATA_READ_RESPONSE_STATUS_IDLE:
-  case CP2112_DATA_READ_RESPONSE_STATUS_ERROR:
-  default:
-    return ReadDataLen;
+**/
+VOID
+StopAsyncReceive (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  //
+  // Once the recovery timer is closed it cannot resubmit the transfer.
+  //
+  if (Dev->ReceiveRecoveryEvent != NULL) {
+    gBS->CloseEvent (Dev->ReceiveRecoveryEvent);
+    Dev->ReceiveRecoveryEvent = NULL;
   }
+  if (!Dev->AsyncReceive) {
+    return;
+  }
+
+  Dev->UsbIo->UsbAsyncInterruptTransfer (
+                Dev->UsbIo,
+                Dev->InEndpointDescriptor.EndpointAddress,
+                FALSE,
+                0,
+                0,
+                NULL,
+                NULL
+                );
+  Dev->AsyncReceive = FALSE;
 }
 
 /**
 
-  Read from an I2C device.
+  Take an input report from the receive ring.
+
+  The ring is filled by the asynchronous interrupt IN transfer, so this only
+  waits while the bridge has not sent anything yet.
 
   @param Dev        Pointer to the MONZAX_DEV instance.
-  @param Address    The memory address to start reading from.
-  @param AddressLen The length of the address in bytes (1 or 2).
-  @param Data       A buffer of bytes to hold the data.
-  @param DataLen    The number of bytes to read.
+  @param Report     The buffer to hold the report, CP2112_REPORT_SIZE bytes.
+  @param ReportLen  On output, the length of the report in bytes.
+  @param Timeout    The time to wait for a report, in milliseconds.
 
-  @return  The number of bytes read.
+  @retval EFI_SUCCESS       The report is received.
+  @retval EFI_TIMEOUT       No report is received in time.
 
 **/
-UINTN
-I2cRead (
+EFI_STATUS
+RingReceiveReport (
   IN MONZAX_DEV           *Dev,
-  IN UINT16               Address,
-  IN UINT8                AddressLen,
-  OUT UINT8               *Data,
-  IN UINTN                DataLen
+  OUT UINT8               *Report,
+  OUT UINTN               *ReportLen,
+  IN UINTN                Timeout
   )
 {
-#define READ_UNIT_SIZE 0x20
-  UINTN       Count;
-  UINTN       LeftByte;
-  UINTN       ReadByte;
-  UINTN       Index;
-  UINTN       ReadDataLen;
-
-  Count = DataLen / READ_UNIT_SIZE;
-  LeftByte = DataLen % READ_UNIT_SIZE;
-  ReadByte = 0;
-
-  for (Index = 0; Index < Count; Index++) {
-    ReadDataLen = I2cReadUnit (
-                    Dev,
-                    (UINT16)(Address + ReadByte),
-                    AddressLen,
-                    Data + ReadByte,
-                    READ_UNIT_SIZE
-                    );
-    ReadByte += ReadDataLen;
-    if (ReadDataLen != READ_UNIT_SIZE) {
-      DEBUG ((EFI_D_ERROR, "I2cRead - partial read 1\n"));
-      return ReadByte;
-    }
-  }
-
-  if (LeftByte != 0) {
-    ReadDataLen = I2cReadUnit (
-                    Dev,
-                    (UINT16)(Address + ReadByte),
-                    AddressLen,
-                    Data + ReadByte,
-                    LeftByte
-                    );
-    ReadByte += ReadDataLen;
-    if (ReadDataLen != LeftByte) {
-      DEBUG((EFI_D_ERROR, "I2cRead - partial read 2\n"));
-      return ReadByte;
+  MONZAX_REPORT        *Entry;
+  UINTN                Tail;
+  UINTN                Delay;
+
+  Tail = Dev->ReceiveTail;
+  Delay = Timeout * 1000;
+  while (Dev->ReceiveHead == Tail) {
+    if (Delay < MONZAX_RECEIVE_POLL_INTERVAL) {
+      return EFI_TIMEOUT;
     }
+    gBS->Stall (MONZAX_RECEIVE_POLL_INTERVAL);
+    Delay -= MONZAX_RECEIVE_POLL_INTERVAL;
   }
-  return ReadByte;
+
+  Entry = &Dev->ReceiveRing[Tail % MONZAX_RECEIVE_RING_SIZE];
+  *ReportLen = Entry->Length;
+  CopyMem (Report, Entry->Data, Entry->Length);
+  Dev->ReceiveTail = Tail + 1;
+
+  return EFI_SUCCESS;
 }
 
 /**
 
-  Write a unit to an I2C device. 
+  Receive an input report from the CP2112 interrupt IN endpoint.
+
+  The wait is bounded by the adaptive report timeout and by the time left
+  of the operation. The latency of the report updates the timeout. A report
+  that does not come drops the latency model, so the next report gets the
+  longest timeout again.
 
   @param Dev        Pointer to the MONZAX_DEV instance.
-  @param Address    The memory address to start writing to.
-  @param AddressLen The length of the address in bytes (1 or 2).
-  @param Data       The words to write.
-  @param DataLen    The number of words to write.
+  @param Report     The buffer to hold the report, CP2112_REPORT_SIZE bytes.
+  @param ReportLen  On output, the length of the report in bytes.
+  @param BusBytes   The bytes the bridge moves on the SMBus before the report.
+  @param TimeLeft   The time left of the operation, in ms.
 
-  @return The number of words written.
+  @retval EFI_SUCCESS       The report is received.
+  @retval EFI_TIMEOUT       No report is received in time.
+  @retval EFI_DEVICE_ERROR  The report cannot be received.
 
 **/
-UINTN
-I2cWriteUnit (
+EFI_STATUS
+UsbReceiveReport (
   IN MONZAX_DEV           *Dev,
-  IN UINT16               Address,
-  IN UINT8                AddressLen,
-  IN UINT16               *Data,
-  IN UINTN                DataLen
+  OUT UINT8               *Report,
+  OUT UINTN               *ReportLen,
+  IN UINTN                BusBytes,
+  IN UINTN                TimeLeft
   )
 {
-  EFI_USB_IO_PROTOCOL  *UsbIo;
   EFI_STATUS           Status;
   UINT32               UsbStatus;
+  UINT64               TraceStart;
+  UINT64               Start;
+  UINTN                Timeout;
+
+  TraceStart = MONZAX_TRACE_BEGIN ();
+  Start = GetPerformanceCounter ();
+  Timeout = MIN (GetReportTimeout (Dev, BusBytes), TimeLeft);
+  if (Timeout == 0) {
+    //
+    // A timeout of 0 would wait forever.
+    //
+    *ReportLen = 0;
+    Status = EFI_TIMEOUT;
+  } else if (Dev->AsyncReceive) {
+    Status = RingReceiveReport (Dev, Report, ReportLen, Timeout);
+    if (EFI_ERROR (Status)) {
+      *ReportLen = 0;
+      DEBUG ((EFI_D_ERROR, "UsbReceiveReport - Ring - Status %r\n", Status));
+    }
+  } else {
+    Dev->InterruptTransferCount++;
+    *ReportLen = CP2112_REPORT_SIZE;
+    Status = Dev->UsbIo->UsbSyncInterruptTransfer (
+                           Dev->UsbIo,
+                           Dev->InEndpointDescriptor.EndpointAddress,
+                           Report,
+                           ReportLen,
+                           Timeout,
+                           &UsbStatus
+                           );
+    if (!EFI_ERROR (Status) && (UsbStatus != EFI_USB_NOERROR)) {
+      Status = EFI_DEVICE_ERROR;
+    }
+    if (EFI_ERROR (Status)) {
+      *ReportLen = 0;
+      DEBUG ((EFI_D_ERROR, "UsbReceiveReport - Status %r, UsbStatus - 0x%08x\n", Status, UsbStatus));
+    }
+  }
+  MONZAX_TRACE (Dev, MonzaXTraceReportIn, 0, (*ReportLen != 0) ? Report[0] : 0, *ReportLen, Status, TraceStart);
+  if (EFI_ERROR (Status)) {
+    Dev->ReportLatency = 0;
+    return (Status == EFI_TIMEOUT) ? EFI_TIMEOUT : EFI_DEVICE_ERROR;
+  }
+  UpdateReportLatency (Dev, GetElapsedTime (Dev, Start), BusBytes);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Check command before read/write a unit from/to an I2C device. 
+
+  The transfer status is polled until the bridge is free, backing off
+  between polls, for at most the operation budget. A failed transfer is
+  final, the bridge keeps reporting the error until the next transfer
+  starts. It is returned as EFI_DEVICE_ERROR with Dev->TransferStatus
+  idle, see CheckBridgeReady() for a check that happens to see it later.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  
+  @return device status.
+
+**/
+EFI_STATUS
+CheckCommand (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  EFI_STATUS           Status;
   UINTN                DataLength;
-  UINTN                Index;
+  UINT64               Start;
+  UINT64               Budget;
+  UINTN                TimeLeft;
+  UINTN                PollDelay;
 
-  CP2112_DATA_WRITE_STRUCT   DataWrite;
+  CP2112_TRANSFER_STATUS_REQUEST_STRUCT  CommandCheck;
+  CP2112_TRANSFER_STATUS_RESPONSE_STRUCT *ReponseCheck;
+  UINT8                                  Buffer[CP2112_REPORT_SIZE];
 
-  DEBUG ((EFI_D_INFO, "I2cWrite(Usb) - Addr (0x%x), Size (0x%x)\n", Address, DataLen));
+  DEBUG ((EFI_D_INFO, "CheckCommand - 0x%02x\n", Dev->OutEndpointDescriptor.EndpointAddress));
 
-  ASSERT (DataLen == 1);
+  Dev->TransferStatus = MonzaXTransferStatusUnknown;
 
-  UsbIo = Dev->UsbIo;
+  //
+  // The bridge may still be on the longest transfer it can have in progress.
+  //
+  Start = GetPerformanceCounter ();
+  Budget = GetOperationBudget (Dev, CP2112_DATA_READ_MAX_LENGTH);
+  PollDelay = MONZAX_POLL_DELAY_MIN;
 
-  Status = CheckCommand (Dev);
+ContinueCheck:
+  TimeLeft = GetTimeLeft (Dev, Start, Budget);
+  if (TimeLeft == 0) {
+    DEBUG ((EFI_D_ERROR, "CheckCommand - bridge busy for %ld us\n", GetElapsedTime (Dev, Start)));
+    return EFI_TIMEOUT;
+  }
+  ZeroMem (&CommandCheck, sizeof(CommandCheck));
+  CommandCheck.Command = CP2112_TRANSFER_STATUS_REQUEST;
+  CommandCheck.Request = CP2112_TRANSFER_STATUS_REQUEST_SMBUS_TRANSFER_STATUS;
+  Status = UsbSendReport (Dev, &CommandCheck, sizeof(CommandCheck));
   if (EFI_ERROR (Status)) {
-    return 0;
+    return EFI_DEVICE_ERROR;
   }
 
-  DataWrite.Command = CP2112_DATA_WRITE;
-  DataWrite.SlaveAddress = Dev->MonzaxI2cDeviceId << 1;
-  DataWrite.Length = (UINT8)(AddressLen + DataLen * sizeof(UINT16));
-  if (AddressLen == 1) {
-    DataWrite.Data[0] = (UINT8)Address;
-  } else {
-    DataWrite.Data[0] = (UINT8)(Address >> 8);
-    DataWrite.Data[1] = (UINT8)Address;
+  Status = UsbReceiveReport (Dev, Buffer, &DataLength, 0, TimeLeft);
+  if (EFI_ERROR (Status)) {
+    return EFI_DEVICE_ERROR;
   }
-  for (Index = 0; Index < DataLen; Index++) {
-    DataWrite.Data[AddressLen + Index * 2]     = (UINT8)(Data[Index] >> 8);
-    DataWrite.Data[AddressLen + Index * 2 + 1] = (UINT8)Data[Index];
+  ReponseCheck = (CP2112_TRANSFER_STATUS_RESPONSE_STRUCT *)Buffer;
+  if (ReponseCheck->Command == CP2112_TRANSFER_STATUS_RESPONSE) {
+    MonzaxRecordTransferStatus (Dev, ReponseCheck);
   }
-  DataLength = sizeof(DataWrite) - sizeof(DataWrite.Data) + AddressLen + DataLen * sizeof(UINT16);
 
-  DEBUG ((EFI_D_INFO, "I2cWrite - DataWrite - 0x%02x\n", Dev->OutEndpointDescriptor.EndpointAddress));
-  Status = UsbIo->UsbSyncInterruptTransfer (
-                    UsbIo,
-                    Dev->OutEndpointDescriptor.EndpointAddress,
-                    &DataWrite,
-                    &DataLength,
-                    3 * 1000,
-                    &UsbStatus
-                    );
-  DEBUG ((EFI_D_INFO, "I2cWrite - DataWrite - Status %r, UsbStatus - 0x%08x\n", Status, UsbStatus));
-  InternalDumpHex ((UINT8 *)&DataWrite, DataLength);
-  if (EFI_ERROR (Status) || (UsbStatus != EFI_USB_NOERROR)) {
-    return 0;
+  if ((ReponseCheck->Command == CP2112_TRANSFER_STATUS_RESPONSE) &&
+      (ReponseCheck->Status0 == CP2112_TRANSFER_STATUS_RESPONSE_STATUS0_ERROR)) {
+    //
+    // Polling again would only see the same error. The bridge is free.
+    //
+    DEBUG ((EFI_D_ERROR, "CheckCommand - transfer error - 0x%02x\n", ReponseCheck->Status1));
+    Dev->TransferStatus = MonzaXTransferStatusIdle;
+    return EFI_DEVICE_ERROR;
   }
 
-  return DataLen;
+  //
+  // A completed transfer leaves the bridge free for the next one as well.
+  //
+  if ((ReponseCheck->Command != CP2112_TRANSFER_STATUS_RESPONSE) ||
+      ((ReponseCheck->Status0 != CP2112_TRANSFER_STATUS_RESPONSE_STATUS0_IDLE) &&
+       (ReponseCheck->Status0 != CP2112_TRANSFER_STATUS_RESPONSE_STATUS0_COMPLETE))) {
+    gBS->Stall (PollDelay);
+    PollDelay = MIN (PollDelay * 2, MONZAX_POLL_DELAY_MAX);
+    goto ContinueCheck;
+  }
+
+  Dev->TransferStatus = MonzaXTransferStatusIdle;
+  return EFI_SUCCESS;
 }
 
 /**
 
-  Write to an I2C device. 
+  Make sure the bridge is ready before read/write a unit from/to an I2C device.
+
+  In transfer status tracking mode the transfer status is only queried when
+  the outcome of the previous transfer is not known, i.e. after a write, an
+  error, a timeout or an unexpected report.
+
+  Every write confirms its last unit before it returns, and a failed read
+  returns its own error. A transfer error seen here is therefore only news
+  for a unit of the write in progress. Any other error was already reported
+  by the operation that caused it, and only means the bridge is free.
 
   @param Dev        Pointer to the MONZAX_DEV instance.
-  @param Address    The memory address to start writing to.
-  @param AddressLen The length of the address in bytes (1 or 2).
-  @param Data       The words to write.
-  @param DataLen    The number of words to write.
 
-  @return The number of words written.
+  @return device status.
 
 **/
-UINTN
-I2cWrite (
+EFI_STATUS
+CheckBridgeReady (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  EFI_STATUS           Status;
+  BOOLEAN              WritePending;
+
+  if (FeaturePcdGet (PcdMonzaXUsbTrackTransferStatus) &&
+      (Dev->TransferStatus == MonzaXTransferStatusIdle)) {
+    return EFI_SUCCESS;
+  }
+
+  WritePending = (BOOLEAN)(Dev->TransferStatus == MonzaXTransferStatusPending);
+  Status = CheckCommand (Dev);
+  if ((Status == EFI_DEVICE_ERROR) && !WritePending &&
+      (Dev->TransferStatus == MonzaXTransferStatusIdle)) {
+    return EFI_SUCCESS;
+  }
+  return Status;
+}
+
+/**
+
+  Ask the bridge to send the data of the current read.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param DataLen    The number of bytes still expected.
+
+  @return device status.
+
+**/
+EFI_STATUS
+ForceSendRead (
+  IN MONZAX_DEV           *Dev,
+  IN UINTN                DataLen
+  )
+{
+  CP2112_DATA_READ_FORCE_SEND_STRUCT     DataReadForce;
+
+  DataReadForce.Command = CP2112_DATA_READ_FORCE_SEND;
+  DataReadForce.Length = SwapBytes16 ((UINT16)DataLen);
+  return UsbSendReport (Dev, &DataReadForce, sizeof(DataReadForce));
+}
+
+/**
+
+  Cancel the current transfer of the bridge.
+
+  It is used to unwind a read that failed while another request may already
+  be queued, so that no stale response is taken for the next read.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+CancelTransfer (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  CP2112_CANCEL_TRANSFER_STRUCT  Cancel;
+
+  ZeroMem (&Cancel, sizeof(Cancel));
+  Cancel.Command = CP2112_CANCEL_TRANSFER;
+  Cancel.Cancel = CP2112_CANCEL_TRANSFER_CANCEL;
+  UsbSendReport (Dev, &Cancel, sizeof(Cancel));
+
+  Dev->TransferStatus = MonzaXTransferStatusUnknown;
+  Dev->ReadPointerValid = FALSE;
+  if (Dev->AsyncReceive) {
+    Dev->ReceiveTail = Dev->ReceiveHead;
+  }
+}
+
+/**
+
+  Take the next read unit from a segment list.
+
+  @param Segments     The segment list.
+  @param SegmentCount The number of segments.
+  @param Index        On input, the segment to continue. On output, the segment
+                      the unit is taken from.
+  @param Offset       On input, the bytes already taken from segment Index.
+                      On output, updated with the unit.
+  @param Unit         The unit, at most CP2112_DATA_READ_MAX_LENGTH bytes.
+
+  @retval TRUE        A unit is returned.
+  @retval FALSE       All segments are taken.
+
+**/
+BOOLEAN
+NextReadUnit (
+  IN MONZAX_READ_SEGMENT  *Segments,
+  IN UINTN                SegmentCount,
+  IN OUT UINTN            *Index,
+  IN OUT UINTN            *Offset,
+  OUT MONZAX_READ_SEGMENT *Unit
+  )
+{
+  MONZAX_READ_SEGMENT  *Segment;
+
+  while ((*Index < SegmentCount) && (*Offset >= Segments[*Index].DataLen)) {
+    (*Index)++;
+    *Offset = 0;
+  }
+  if (*Index >= SegmentCount) {
+    return FALSE;
+  }
+
+  Segment = &Segments[*Index];
+  Unit->I2cDeviceId = Segment->I2cDeviceId;
+  Unit->Address     = (UINT16)(Segment->Address + *Offset);
+  Unit->AddressLen  = Segment->AddressLen;
+  Unit->Data        = Segment->Data + *Offset;
+  Unit->DataLen     = MIN (Segment->DataLen - *Offset, CP2112_DATA_READ_MAX_LENGTH);
+  *Offset += Unit->DataLen;
+  return TRUE;
+}
+
+/**
+
+  Send the read request of a unit to the bridge.
+
+  A unit starting at the internal address pointer of the chip is sent as a
+  DATA_READ_REQUEST with no target address when PcdMonzaXSequentialRead is
+  TRUE, otherwise as a DATA_WRITE_READ_REQUEST.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Unit       The unit to read.
+
+  @return device status.
+
+**/
+EFI_STATUS
+IssueReadRequest (
+  IN MONZAX_DEV           *Dev,
+  IN MONZAX_READ_SEGMENT  *Unit
+  )
+{
+  EFI_STATUS                             Status;
+  UINTN                                  DataLength;
+  CP2112_DATA_READ_REQUEST_STRUCT        DataRead;
+  CP2112_DATA_WRITE_READ_REQUEST_STRUCT  DataWriteRead;
+
+  DEBUG ((EFI_D_INFO, "I2cRead(Usb) - Slave (0x%x), Addr (0x%x), Size (0x%x)\n", Unit->I2cDeviceId, Unit->Address, Unit->DataLen));
+
+  ASSERT ((Unit->DataLen != 0) && (Unit->DataLen <= CP2112_DATA_READ_MAX_LENGTH));
+
+  //
+  // The outcome stays unknown until the bridge reports completion.
+  //
+  Dev->TransferStatus = MonzaXTransferStatusUnknown;
+
+  if (FeaturePcdGet (PcdMonzaXSequentialRead) && Dev->ReadPointerValid &&
+      (Dev->ReadPointerSlave == Unit->I2cDeviceId) && (Dev->ReadPointer == Unit->Address)) {
+    //
+    // Current address read, the chip goes on from where it stopped.
+    //
+    DataRead.Command = CP2112_DATA_READ_REQUEST;
+    DataRead.SlaveAddress = Unit->I2cDeviceId << 1;
+    DataRead.Length = SwapBytes16 ((UINT16)Unit->DataLen);
+
+    DEBUG ((EFI_D_INFO, "I2cRead - DataRead - 0x%02x\n", Dev->OutEndpointDescriptor.EndpointAddress));
+    Dev->ReadPointerValid = FALSE;
+    Status = UsbSendReport (Dev, &DataRead, sizeof(DataRead));
+  } else {
+    DataWriteRead.Command = CP2112_DATA_WRITE_READ_REQUEST;
+    DataWriteRead.SlaveAddress = Unit->I2cDeviceId << 1;
+    DataWriteRead.Length = SwapBytes16 ((UINT16)Unit->DataLen);
+    DataWriteRead.TargetAddressLength = Unit->AddressLen;
+    if (Unit->AddressLen == 1) {
+      DataWriteRead.TargetAddress[0] = (UINT8)Unit->Address;
+    } else {
+      DataWriteRead.TargetAddress[0] = (UINT8)(Unit->Address >> 8);
+      DataWriteRead.TargetAddress[1] = (UINT8)Unit->Address;
+    }
+    DataLength = sizeof(DataWriteRead) - sizeof(DataWriteRead.TargetAddress) + Unit->AddressLen;
+
+    DEBUG ((EFI_D_INFO, "I2cRead - DataWriteRead - 0x%02x\n", Dev->OutEndpointDescriptor.EndpointAddress));
+    Dev->ReadPointerValid = FALSE;
+    Status = UsbSendReport (Dev, &DataWriteRead, DataLength);
+  }
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Dev->StatusRecorded = FALSE;
+
+  //
+  // Where the next unit may continue, if this one completes. A failed unit
+  // is cancelled, which drops the pointer again.
+  //
+  Dev->ReadPointerValid = TRUE;
+  Dev->ReadPointerSlave = Unit->I2cDeviceId;
+  Dev->ReadPointer      = (UINT16)(Unit->Address + Unit->DataLen);
+
+  //
+  // With auto send read the bridge sends the data on its own.
+  //
+  if (Dev->SmbusConfig.AutoSendRead != 0) {
+    return EFI_SUCCESS;
+  }
+  return ForceSendRead (Dev, Unit->DataLen);
+}
+
+/**
+
+  Drain the response reports of a unit.
+
+  The data streams back in consecutive DATA_READ_RESPONSE reports, which are
+  copied straight into the unit buffer. As soon as a report shows that the
+  bridge is done with the unit on the SMBus, the request of the next unit is
+  sent, while the rest of the unit is still drained. The bridge keeps its
+  data in order, so bytes past the end of the unit belong to the next unit
+  and are copied to it. The polls of a bridge that has no data yet back off,
+  and the whole unit is bounded by the operation budget.
+
+  With auto send read the responses come unsolicited, and the transfer status
+  is only polled when no report comes in time. In both modes a transfer
+  error ends the unit at once.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Request    The unit being read. ReadDataLen and Complete are updated.
+  @param Next       Optional. The unit to send once the bus is done with
+                    Request. Issued is set once it is sent.
+
+  @retval EFI_SUCCESS       The whole unit is read, and Next, if any, is sent.
+  @retval EFI_TIMEOUT       The unit did not complete within the budget.
+  @retval EFI_DEVICE_ERROR  The unit or the request of Next failed.
+
+**/
+EFI_STATUS
+DrainReadUnit (
+  IN MONZAX_DEV           *Dev,
+  IN MONZAX_READ_REQUEST  *Request,
+  IN MONZAX_READ_REQUEST  *Next     OPTIONAL
+  )
+{
+  EFI_STATUS           Status;
+  UINTN                DataLength;
+  UINT64               Start;
+  UINT64               Budget;
+  UINTN                TimeLeft;
+  UINTN                PollDelay;
+  UINTN                ReportLen;
+  UINTN                CopyLen;
+  UINTN                Pending;
+  BOOLEAN              NextIssued;
+
+  CP2112_DATA_READ_RESPONSE_STRUCT       *ReadResponse;
+  CP2112_TRANSFER_STATUS_REQUEST_STRUCT  CommandCheck;
+
+  UINT8                Buffer[CP2112_REPORT_SIZE];
+
+  //
+  // The slave address and the memory address go on the bus with the data.
+  //
+  Start = GetPerformanceCounter ();
+  Budget = GetOperationBudget (Dev, Request->Unit.DataLen + 3);
+  PollDelay = MONZAX_POLL_DELAY_MIN;
+
+  while (TRUE) {
+    NextIssued = (BOOLEAN)((Next != NULL) && Next->Issued);
+    if (Request->Complete && (Next != NULL) && !NextIssued) {
+      //
+      // The bus is free. Start the next unit while the bridge still holds
+      // the rest of this one.
+      //
+      Status = IssueReadRequest (Dev, &Next->Unit);
+      if (EFI_ERROR (Status)) {
+        DEBUG ((EFI_D_ERROR, "I2cRead - issue next unit fail - %r\n", Status));
+        return EFI_DEVICE_ERROR;
+      }
+      Next->Issued = TRUE;
+      NextIssued = TRUE;
+    }
+    if (Request->Complete && (Request->ReadDataLen >= Request->Unit.DataLen)) {
+      return EFI_SUCCESS;
+    }
+
+    TimeLeft = GetTimeLeft (Dev, Start, Budget);
+    if (TimeLeft == 0) {
+      DEBUG ((EFI_D_ERROR, "I2cRead(Usb) - ContinueRead fail read - 0x%x\n", Request->ReadDataLen));
+      return EFI_TIMEOUT;
+    }
+    Status = UsbReceiveReport (
+               Dev,
+               Buffer,
+               &DataLength,
+               MIN (Request->Unit.DataLen - Request->ReadDataLen, CP2112_DATA_READ_RESPONSE_MAX_LENGTH),
+               TimeLeft
+               );
+    if (EFI_ERROR (Status)) {
+      if ((Status != EFI_TIMEOUT) || (Dev->SmbusConfig.AutoSendRead == 0)) {
+        return Status;
+      }
+      //
+      // The bus may still be busy, e.g. with the chip NACKing its address
+      // during a write cycle, or the transfer failed and no data is coming.
+      // Ask, rather than wait out the budget.
+      //
+      goto PollStatus;
+    }
+
+    ReadResponse = (CP2112_DATA_READ_RESPONSE_STRUCT *)Buffer;
+
+    if (ReadResponse->Command != CP2112_DATA_READ_RESPONSE) {
+      if (ReadResponse->Command == CP2112_TRANSFER_STATUS_RESPONSE) {
+        MonzaxRecordTransferStatus (Dev, (CP2112_TRANSFER_STATUS_RESPONSE_STRUCT *)Buffer);
+        if (((CP2112_TRANSFER_STATUS_RESPONSE_STRUCT *)Buffer)->Status0 == CP2112_TRANSFER_STATUS_RESPONSE_STATUS0_ERROR) {
+          //
+          // The read failed on the bus, no data is coming.
+          //
+          return EFI_DEVICE_ERROR;
+        }
+      }
+      if (Dev->SmbusConfig.AutoSendRead != 0) {
+        //
+        // A stale report, the data comes without asking.
+        //
+        continue;
+      }
+      goto PollStatus;
+    }
+
+    ReportLen = MIN (ReadResponse->Length, CP2112_DATA_READ_RESPONSE_MAX_LENGTH);
+    CopyLen = MIN (ReportLen, Request->Unit.DataLen - Request->ReadDataLen);
+    CopyMem (Request->Unit.Data + Request->ReadDataLen, ReadResponse->Data, CopyLen);
+    Request->ReadDataLen += CopyLen;
+    if (NextIssued && (ReportLen > CopyLen)) {
+      ReportLen = MIN (ReportLen - CopyLen, Next->Unit.DataLen - Next->ReadDataLen);
+      CopyMem (Next->Unit.Data + Next->ReadDataLen, ReadResponse->Data + CopyLen, ReportLen);
+      Next->ReadDataLen += ReportLen;
+    }
+    if (ReadResponse->Length != 0) {
+      PollDelay = MONZAX_POLL_DELAY_MIN;
+    }
+    switch (ReadResponse->Status) {
+    case CP2112_DATA_READ_RESPONSE_STATUS_COMPLETE:
+      //
+      // The status is the one of the last unit sent. A report without data
+      // of the next unit may still be from before its request.
+      //
+      if (!NextIssued) {
+        Request->Complete = TRUE;
+        Dev->TransferStatus = MonzaXTransferStatusIdle;
+      } else if (Next->ReadDataLen != 0) {
+        Next->Complete = TRUE;
+        Dev->TransferStatus = MonzaXTransferStatusIdle;
+      }
+      continue;
+    case CP2112_DATA_READ_RESPONSE_STATUS_BUSY:
+      if (ReadResponse->Length == 0) {
+        //
+        // Nothing was buffered yet when the force send was handled. Ask again
+        // for the rest instead of waiting for a report that never comes.
+        //
+        Pending = Request->Unit.DataLen - Request->ReadDataLen;
+        if (NextIssued) {
+          Pending += Next->Unit.DataLen - Next->ReadDataLen;
+        }
+        gBS->Stall (PollDelay);
+        PollDelay = MIN (PollDelay * 2, MONZAX_POLL_DELAY_MAX);
+        Status = ForceSendRead (Dev, MIN (Pending, CP2112_DATA_READ_MAX_LENGTH));
+        if (EFI_ERROR (Status)) {
+          return Status;
+        }
+      }
+      continue;
+    case CP2112_DATA_READ_RESPONSE_STATUS_IDLE:
+    case CP2112_DATA_READ_RESPONSE_STATUS_ERROR:
+    default:
+      return EFI_DEVICE_ERROR;
+    }
+
+PollStatus:
+    gBS->Stall (PollDelay);
+    PollDelay = MIN (PollDelay * 2, MONZAX_POLL_DELAY_MAX);
+
+    ZeroMem (&CommandCheck, sizeof(CommandCheck));
+    CommandCheck.Command = CP2112_TRANSFER_STATUS_REQUEST;
+    CommandCheck.Request = CP2112_TRANSFER_STATUS_REQUEST_SMBUS_TRANSFER_STATUS;
+    Status = UsbSendReport (Dev, &CommandCheck, sizeof(CommandCheck));
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+}
+
+/**
+
+  Select the multiplexer channel of the chip.
+
+  The select is only sent when Dev->MuxChannel differs from the channel
+  selected last. The channel is only taken as selected once the transfer
+  status shows that the multiplexer acknowledged it, so a select that is
+  NACKed is sent again by the next access.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS The channel is selected, or there is no multiplexer.
+  @retval Others      The select could not be sent or is not acknowledged.
+
+**/
+EFI_STATUS
+SelectMuxChannel (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  EFI_STATUS                 Status;
+  UINT64                     TraceStart;
+  CP2112_DATA_WRITE_STRUCT   DataWrite;
+
+  if ((Dev->MuxAddress == 0) || (Dev->MuxChannel == MONZAX_MUX_CHANNEL_NONE) ||
+      (Dev->MuxSelected == Dev->MuxChannel)) {
+    return EFI_SUCCESS;
+  }
+
+  TraceStart = MONZAX_TRACE_BEGIN ();
+
+  Status = CheckBridgeReady (Dev);
+  if (!EFI_ERROR (Status)) {
+    DataWrite.Command = CP2112_DATA_WRITE;
+    DataWrite.SlaveAddress = (UINT8)(Dev->MuxAddress << 1);
+    DataWrite.Length = 1;
+    DataWrite.Data[0] = (UINT8)(1 << Dev->MuxChannel);
+    Status = UsbSendReport (Dev, &DataWrite, sizeof(DataWrite) - sizeof(DataWrite.Data) + 1);
+    if (!EFI_ERROR (Status)) {
+      Dev->StatusRecorded = FALSE;
+      Status = CheckCommand (Dev);
+    }
+  }
+  MONZAX_TRACE (Dev, MonzaXTraceMuxSelect, Dev->MuxAddress, Dev->MuxChannel, EFI_ERROR (Status) ? 0 : 1, Status, TraceStart);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "SelectMuxChannel %d - %r\n", Dev->MuxChannel, Status));
+    Dev->TransferStatus = MonzaXTransferStatusUnknown;
+    Dev->MuxSelected = MONZAX_MUX_CHANNEL_NONE;
+    return Status;
+  }
+
+  Dev->MuxSelected = Dev->MuxChannel;
+  //
+  // The chip behind the new channel has a pointer of its own.
+  //
+  Dev->ReadPointerValid = FALSE;
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Read a list of segments from I2C devices.
+
+  Each segment is read in units of up to CP2112_DATA_READ_MAX_LENGTH bytes.
+  The request of a unit is sent as soon as the bridge is done with the
+  previous unit on the SMBus, while its data is still drained, so the bus
+  keeps moving between units and segments. The segment buffers must be
+  contiguous, in list order.
+
+  @param Dev          Pointer to the MONZAX_DEV instance.
+  @param Segments     The segment list.
+  @param SegmentCount The number of segments.
+
+  @return  The number of bytes read, counted from the first segment.
+
+**/
+UINTN
+I2cReadSegments (
+  IN MONZAX_DEV           *Dev,
+  IN MONZAX_READ_SEGMENT  *Segments,
+  IN UINTN                SegmentCount
+  )
+{
+  EFI_STATUS           Status;
+  MONZAX_READ_REQUEST  Requests[2];
+  MONZAX_READ_REQUEST  *Current;
+  MONZAX_READ_REQUEST  *Next;
+  BOOLEAN              HasNext;
+  UINTN                Index;
+  UINTN                Offset;
+  UINTN                ReadByte;
+  UINT64               TraceStart;
+  UINT64               Start;
+
+  ReadByte = 0;
+  Index = 0;
+  Offset = 0;
+
+  ZeroMem (Requests, sizeof(Requests));
+  Current = &Requests[0];
+  Next = &Requests[1];
+  if (!NextReadUnit (Segments, SegmentCount, &Index, &Offset, &Current->Unit)) {
+    return 0;
+  }
+
+  Status = SelectMuxChannel (Dev);
+  if (EFI_ERROR (Status)) {
+    return 0;
+  }
+
+  TraceStart = MONZAX_TRACE_BEGIN ();
+  Start = GetPerformanceCounter ();
+
+  Status = CheckBridgeReady (Dev);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "I2cRead(Usb) - Check Command fail\n"));
+    goto Exit;
+  }
+
+  Status = IssueReadRequest (Dev, &Current->Unit);
+  if (EFI_ERROR (Status)) {
+    CancelTransfer (Dev);
+    goto Exit;
+  }
+  Current->Issued = TRUE;
+
+  while (TRUE) {
+    Next->ReadDataLen = 0;
+    Next->Complete    = FALSE;
+    Next->Issued      = FALSE;
+    HasNext = NextReadUnit (Segments, SegmentCount, &Index, &Offset, &Next->Unit);
+    Status = DrainReadUnit (Dev, Current, HasNext ? Next : NULL);
+    if (EFI_ERROR (Status)) {
+      //
+      // Only the data of the current unit counts. The next request may be
+      // sent, or half sent. Drop it.
+      //
+      DEBUG ((EFI_D_ERROR, "I2cRead - partial read - %r\n", Status));
+      ReadByte += Current->ReadDataLen;
+      CancelTransfer (Dev);
+      break;
+    }
+    ReadByte += Current->Unit.DataLen;
+    if (!HasNext) {
+      break;
+    }
+    Current = Next;
+    Next = (Current == &Requests[0]) ? &Requests[1] : &Requests[0];
+  }
+
+Exit:
+  if (EFI_ERROR (Status)) {
+    Dev->ReadPointerValid = FALSE;
+  }
+  MonzaxRecordLatency (Dev, FALSE, Start);
+  MONZAX_TRACE (Dev, MonzaXTraceI2cRead, Segments[0].I2cDeviceId, Segments[0].Address, ReadByte, Status, TraceStart);
+  return ReadByte;
+}
+
+/**
+
+  Read from an I2C device.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param I2cDeviceId The I2C slave address to read from.
+  @param Address    The memory address to start reading from.
+  @param AddressLen The length of the address in bytes (1 or 2).
+  @param Data       A buffer of bytes to hold the data.
+  @param DataLen    The number of bytes to read.
+
+  @return  The number of bytes read.
+
+**/
+UINTN
+I2cRead (
+  IN MONZAX_DEV           *Dev,
+  IN UINT8                I2cDeviceId,
+  IN UINT16               Address,
+  IN UINT8                AddressLen,
+  OUT UINT8               *Data,
+  IN UINTN                DataLen
+  )
+{
+  MONZAX_READ_SEGMENT  Segment;
+
+  Segment.I2cDeviceId = I2cDeviceId;
+  Segment.Address     = Address;
+  Segment.AddressLen  = AddressLen;
+  Segment.Data        = Data;
+  Segment.DataLen     = DataLen;
+  return I2cReadSegments (Dev, &Segment, 1);
+}
+
+/**
+
+  Write a unit to an I2C device. 
+
+  All words of a unit are sent in a single DATA_WRITE report, so the unit
+  must fit in CP2112_DATA_WRITE_STRUCT.Data and must not cross a MonzaX
+  write page.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param I2cDeviceId The I2C slave address to write to.
+  @param Address    The memory address to start writing to.
+  @param AddressLen The length of the address in bytes (1 or 2).
+  @param Data       The words to write.
+  @param DataLen    The number of words to write.
+
+  @return The number of words written.
+
+**/
+UINTN
+I2cWriteUnit (
+  IN MONZAX_DEV           *Dev,
+  IN UINT8                I2cDeviceId,
+  IN UINT16               Address,
+  IN UINT8                AddressLen,
+  IN UINT16               *Data,
+  IN UINTN                DataLen
+  )
+{
+  EFI_STATUS           Status;
+  UINTN                DataLength;
+  UINT64               TraceStart;
+  UINT64               Start;
+
+  CP2112_DATA_WRITE_STRUCT   DataWrite;
+
+  ASSERT ((DataLen != 0) && (AddressLen + DataLen * sizeof(UINT16) <= sizeof(DataWrite.Data)));
+
+  Dev->ReadPointerValid = FALSE;
+
+  Status = SelectMuxChannel (Dev);
+  if (EFI_ERROR (Status)) {
+    return 0;
+  }
+
+  TraceStart = MONZAX_TRACE_BEGIN ();
+  Start = GetPerformanceCounter ();
+
+  Status = CheckBridgeReady (Dev);
+  if (EFI_ERROR (Status)) {
+    MonzaxRecordLatency (Dev, TRUE, Start);
+    MONZAX_TRACE (Dev, MonzaXTraceI2cWrite, I2cDeviceId, Address, 0, Status, TraceStart);
+    return 0;
+  }
+
+  DataWrite.Command = CP2112_DATA_WRITE;
+  DataWrite.SlaveAddress = (UINT8)(I2cDeviceId << 1);
+  DataWrite.Length = (UINT8)(AddressLen + DataLen * sizeof(UINT16));
+  if (AddressLen == 1) {
+    DataWrite.Data[0] = (UINT8)Address;
+  } else {
+    DataWrite.Data[0] = (UINT8)(Address >> 8);
+    DataWrite.Data[1] = (UINT8)Address;
+  }
+  // Words are sent in memory order, same as the native I2C driver.
+  CopyMem (&DataWrite.Data[AddressLen], Data, DataLen * sizeof(UINT16));
+  DataLength = sizeof(DataWrite) - sizeof(DataWrite.Data) + AddressLen + DataLen * sizeof(UINT16);
+
+  Status = UsbSendReport (Dev, &DataWrite, DataLength);
+  MonzaxRecordLatency (Dev, TRUE, Start);
+  MONZAX_TRACE (Dev, MonzaXTraceI2cWrite, I2cDeviceId, Address, EFI_ERROR (Status) ? 0 : DataLen * sizeof(UINT16), Status, TraceStart);
+  if (EFI_ERROR (Status)) {
+    Dev->TransferStatus = MonzaXTransferStatusUnknown;
+    return 0;
+  }
+
+  //
+  // The bridge is busy until the data is on the bus, and the outcome of the
+  // write is only known after the next transfer status check, which
+  // I2cWrite makes before it returns.
+  //
+  Dev->TransferStatus = MonzaXTransferStatusPending;
+  Dev->StatusRecorded = FALSE;
+
+  return DataLen;
+}
+
+/**
+
+  Write to an I2C device. 
+
+  A unit is only counted once the bridge reports that it completed on the
+  bus: the check before the next unit confirms the previous one, and the
+  last unit is confirmed before returning. A unit that cannot be confirmed
+  is not counted, so the caller does not cache data the chip never stored.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param I2cDeviceId The I2C slave address to write to.
+  @param Address    The memory address to start writing to.
+  @param AddressLen The length of the address in bytes (1 or 2).
+  @param Data       The words to write.
+  @param DataLen    The number of words to write.
+
+  @return The number of words written.
+
+**/
+UINTN
+I2cWrite (
+  IN MONZAX_DEV           *Dev,
+  IN UINT8                I2cDeviceId,
+  IN UINT16               Address,
+  IN UINT8                AddressLen,
+  IN UINT16               *Data,
+  IN UINTN                DataLen
+  )
+{
+  UINTN       WriteWord;
+  UINTN       UnitLen;
+  UINTN       PageLeft;
+  UINTN       DataWriteLen;
+  UINTN       PendingLen;
+
+  WriteWord = 0;
+  PendingLen = 0;
+  while (WriteWord < DataLen) {
+    //
+    // Pack as many words as fit in one DATA_WRITE report,
+    // stopping at the end of the current write page.
+    //
+    UnitLen  = (CP2112_DATA_WRITE_MAX_LENGTH - AddressLen) / sizeof(UINT16);
+    PageLeft = (MONZAX_SIZE_BYTES_WRITE_PAGE - ((Address + WriteWord * sizeof(UINT16)) % MONZAX_SIZE_BYTES_WRITE_PAGE)) / sizeof(UINT16);
+    if (UnitLen > PageLeft) {
+      UnitLen = PageLeft;
+    }
+    if (UnitLen > DataLen - WriteWord) {
+      UnitLen = DataLen - WriteWord;
+    }
+
+    DataWriteLen = I2cWriteUnit (
+                     Dev,
+                     I2cDeviceId,
+                     (UINT16)(Address + WriteWord * sizeof(UINT16)),
+                     AddressLen,
+                     Data + WriteWord,
+                     UnitLen
+                     );
+    if (DataWriteLen != UnitLen) {
+      //
+      // The check of this unit may have found the previous one failed.
+      //
+      DEBUG ((EFI_D_ERROR, "I2cWrite - partial write 1\n"));
+      return WriteWord - PendingLen;
+    }
+    WriteWord += DataWriteLen;
+    PendingLen = DataWriteLen;
+  }
+
+  if ((PendingLen != 0) && EFI_ERROR (CheckCommand (Dev))) {
+    DEBUG ((EFI_D_ERROR, "I2cWrite - last unit not confirmed\n"));
+    return WriteWord - PendingLen;
+  }
+
+  return WriteWord;
+}
+
+/**
+
+  Write data to adjusted address.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The memory address to start writing to.
+  @param Data       The words to write.
+  @param DataLen    The number of words to write.
+
+  @return The number of words written.
+
+**/
+UINTN
+WriteAdjustedAddress (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  IN UINT16               *Data,
+  IN UINTN                DataLen
+  )
+{
+  UINTN      Count;
+  UINTN      Len;
+  UINT8      AddressLen;
+  UINT8      I2cDeviceId;
+
+  //
+  // Each transfer carries its own slave address. Dev->MonzaxI2cDeviceId is
+  // never stepped to the upper half, so an interrupting caller cannot see it
+  // off by one.
+  //
+  I2cDeviceId = Dev->MonzaxI2cDeviceId;
+
+  // Handle dual address requirement of Monza X 2K Dura
+  if (Dev->ChipModelType == MonzaX2KDura) {
+    AddressLen = 1;
+
+    // Is the supplied address larger than a byte?
+    // If so, use the next device id and adjust the address.
+    // The lower bit of the device id is the upper bit of the address.
+    if (Address > 0xFF) {
+      Count = I2cWrite (Dev, (UINT8)(I2cDeviceId + 1), (UINT16)(Address - 0x0100), AddressLen, Data, DataLen);
+    }
+    // Will the write operation cross the address boundary (0xFF)?
+    // If  so, write the data in two chunks. This prevents addressing
+    // problems if the end user has implemented i2c_write using a
+    // single word write.
+    else if (Address + (DataLen * sizeof(UINT16) - 1) > 0xFF) {
+      Len = (0xFF - Address + 1) / sizeof(UINT16);
+      Count = I2cWrite (Dev, I2cDeviceId, Address, AddressLen, Data, Len);
+      Count += I2cWrite (Dev, (UINT8)(I2cDeviceId + 1), 0, AddressLen, Data + Len, DataLen - Len);
+    }
+    // Regular write operation.
+    else {
+      Count = I2cWrite (Dev, I2cDeviceId, Address, AddressLen, Data, DataLen);
+    }
+  }
+  // Monza X 8K Dura. Regular write operation.
+  else {
+    AddressLen = 2;
+    Count = I2cWrite (Dev, I2cDeviceId, Address, AddressLen, Data, DataLen);
+  }
+  return Count;
+}
+
+/**
+
+  Read data from adjusted address.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The memory address to start reading from.
+  @param Data       A buffer of bytes to hold the data.
+  @param DataLen    The number of bytes to read.
+
+  @return  The number of bytes read.
+
+**/
+UINTN
+ReadAdjustedAddress (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  OUT UINT8               *Data,
+  IN UINTN                DataLen
+  )
+{
+  UINTN      Count;
+  UINT8      AddressLen;
+  UINTN      Len;
+  MONZAX_READ_SEGMENT  Segments[2];
+  UINT8      I2cDeviceId;
+
+  I2cDeviceId = Dev->MonzaxI2cDeviceId;
+
+  // Handle dual address requirement of Monza X 2K Dura
+  if (Dev->ChipModelType == MonzaX2KDura) {
+    AddressLen = 1;
+
+    // Is the supplied address larger than a byte?
+    // If so, use the next device id and adjust the address.
+    // The lower bit of the device id is the upper bit of the address.
+    if (Address > 0xFF) {
+      Count = I2cRead (Dev, (UINT8)(I2cDeviceId + 1), (UINT16)(Address - 0x0100), AddressLen, Data, DataLen);
+    }
+    // Will the read operation cross the address boundary (0xFF)?
+    // If  so, read the data in two chunks. This prevents addressing
+    // problems if the end user has implemented i2c_read using a
+    // single byte read.
+    // Both chunks go through the read engine in one go, so the second
+    // request is sent as soon as the first chunk completes.
+    else if (Address + (DataLen - 1) > 0xFF) {
+      Len = 0xFF - Address + 1;
+      Segments[0].I2cDeviceId = I2cDeviceId;
+      Segments[0].Address     = Address;
+      Segments[0].AddressLen  = AddressLen;
+      Segments[0].Data        = Data;
+      Segments[0].DataLen     = Len;
+      Segments[1].I2cDeviceId = (UINT8)(I2cDeviceId + 1);
+      Segments[1].Address     = 0;
+      Segments[1].AddressLen  = AddressLen;
+      Segments[1].Data        = Data + Len;
+      Segments[1].DataLen     = DataLen - Len;
+      Count = I2cReadSegments (Dev, Segments, 2);
+    }
+    // Regular read operation.
+    else {
+      Count = I2cRead (Dev, I2cDeviceId, Address, AddressLen, Data, DataLen);
+    }
+  }
+  // Monza X 8K Dura. Regular read operation.
+  else {
+    AddressLen = 2;
+    Count = I2cRead (Dev, I2cDeviceId, Address, AddressLen, Data, DataLen);
+  }
+
+  return Count;
+}
+
+/**
+
+  Get the size of the memory of the chip model in use.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @return The size, in bytes, of the address space.
+
+**/
+UINTN
+GetMemorySize (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  if (Dev->ChipModelType == MonzaX8KDura) {
+    return MONZAX_SIZE_BYTES_MEMORY_8K;
+  }
+  return MONZAX_SIZE_BYTES_MEMORY_2K;
+}
+
+/**
+
+  Get the valid bits of the cache blocks holding a range of the memory.
+
+  @param Address    The device address of the first byte.
+  @param DataLen    The number of bytes, not 0.
+
+  @return The valid bits of the blocks.
+
+**/
+UINT32
+GetCacheBlockMask (
+  IN UINTN                Address,
+  IN UINTN                DataLen
+  )
+{
+  UINTN      First;
+  UINTN      Last;
+
+  First = Address / MONZAX_CACHE_BLOCK_SIZE;
+  Last = (Address + DataLen - 1) / MONZAX_CACHE_BLOCK_SIZE;
+  ASSERT (Last < MONZAX_CACHE_BLOCK_COUNT);
+  return (UINT32)((2U << Last) - (1U << First));
+}
+
+/**
+
+  Read the cache blocks holding a range of the memory that are not valid yet.
+
+  Adjacent missing blocks are read with one transfer.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of the first byte.
+  @param DataLen    The number of bytes, not 0. The range must be within the memory.
+
+  @retval TRUE      All the blocks holding the range are valid.
+  @retval FALSE     The chip could not be read, or the cache was invalidated meanwhile.
+
+**/
+BOOLEAN
+FillCache (
+  IN MONZAX_DEV           *Dev,
+  IN UINTN                Address,
+  IN UINTN                DataLen
+  )
+{
+  UINT32     Generation;
+  UINTN      Block;
+  UINTN      Last;
+  UINTN      Start;
+  UINTN      Offset;
+  UINTN      Length;
+
+  Generation = Dev->CacheGeneration;
+  Block = Address / MONZAX_CACHE_BLOCK_SIZE;
+  Last = (Address + DataLen - 1) / MONZAX_CACHE_BLOCK_SIZE;
+  while (Block <= Last) {
+    if ((Dev->CacheValid & (1U << Block)) != 0) {
+      Block++;
+      continue;
+    }
+    Start = Block;
+    while ((Block <= Last) && ((Dev->CacheValid & (1U << Block)) == 0)) {
+      Block++;
+    }
+    // The last block of a 2K Dura is only partly backed by memory.
+    Offset = Start * MONZAX_CACHE_BLOCK_SIZE;
+    Length = MIN (Block * MONZAX_CACHE_BLOCK_SIZE, GetMemorySize (Dev)) - Offset;
+    if (ReadAdjustedAddress (Dev, (UINT16) Offset, Dev->Cache + Offset, Length) != Length) {
+      return FALSE;
+    }
+    if (Dev->CacheGeneration != Generation) {
+      return FALSE;
+    }
+    Dev->CacheValid |= GetCacheBlockMask (Offset, Length);
+  }
+  return TRUE;
+}
+
+/**
+
+  Copy written data into the cache.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address the data is written to.
+  @param Data       A pointer to the data written.
+  @param DataLen    The size, in bytes, of the data.
+  @param Complete   TRUE if all the data reached the chip.
+
+**/
+VOID
+UpdateCache (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  IN UINT8                *Data,
+  IN UINTN                DataLen,
+  IN BOOLEAN              Complete
+  )
+{
+  if ((DataLen == 0) || (Address >= MONZAX_SIZE_BYTES_MEMORY_8K)) {
+    return;
+  }
+  DataLen = MIN (DataLen, MONZAX_SIZE_BYTES_MEMORY_8K - Address);
+  if (Complete) {
+    CopyMem (Dev->Cache + Address, Data, DataLen);
+  } else {
+    // The chip contents are unknown after a partial write.
+    MonzaxInvalidateCache (Dev, Address, DataLen);
+  }
+}
+
+/**
+
+  Drop a range of the memory from the cache.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of the first byte.
+  @param DataLen    The number of bytes. 0 drops the whole cache.
+
+**/
+VOID
+MonzaxInvalidateCache (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  IN UINTN                DataLen
+  )
+{
+  if (DataLen == 0) {
+    Dev->CacheValid = 0;
+  } else if (Address < MONZAX_SIZE_BYTES_MEMORY_8K) {
+    DataLen = MIN (DataLen, MONZAX_SIZE_BYTES_MEMORY_8K - Address);
+    Dev->CacheValid &= ~GetCacheBlockMask (Address, DataLen);
+  }
+  Dev->CacheGeneration++;
+}
+
+/**
+
+  Fill the cache with the whole memory of the chip.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+MonzaxWarmUpCache (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  if (!FeaturePcdGet (PcdMonzaXMemoryCache)) {
+    return;
+  }
+  if (!FillCache (Dev, 0, GetMemorySize (Dev))) {
+    DEBUG ((EFI_D_ERROR, "MonzaxWarmUpCache - fail, reads fill the cache on demand\n"));
+  }
+}
+
+/**
+
+  Serve a read from the cache, if the cache holds all of it.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+
+  @retval TRUE      The data is copied from the cache.
+  @retval FALSE     The cache is disabled or does not hold the whole range.
+
+**/
+BOOLEAN
+MonzaxReadCached (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  OUT UINT8               *Data,
+  IN UINTN                DataLen
+  )
+{
+  UINT32     Mask;
+
+  if (!FeaturePcdGet (PcdMonzaXMemoryCache) ||
+      (DataLen == 0) || ((UINTN) Address + DataLen > GetMemorySize (Dev))) {
+    return FALSE;
+  }
+
+  Mask = GetCacheBlockMask (Address, DataLen);
+  if ((Dev->CacheValid & Mask) != Mask) {
+    Dev->CacheMisses++;
+    return FALSE;
+  }
+  Dev->CacheHits++;
+  CopyMem (Data, Dev->Cache + Address, DataLen);
+  return TRUE;
+}
+
+/**
+
+  Read data from MonzaX chip.
+
+  When the cache is enabled, the read is served from the cache and the blocks
+  holding the data are read from the chip first if they are not cached yet.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+
+  @return  The amount of data actually transferred.
+
+**/
+UINTN
+MonzaxReadAddress (
   IN MONZAX_DEV           *Dev,
   IN UINT16               Address,
-  IN UINT8                AddressLen,
-  IN UINT16               *Data,
+  OUT UINT8               *Data,
   IN UINTN                DataLen
   )
 {
-  UINTN       WriteByte;
-  UINTN       Index;
-  UINTN       DataWriteLen;
-
-  WriteByte = 0;
-  for (Index = 0; Index < DataLen; Index++) {
-    DataWriteLen = I2cWriteUnit (
-                     Dev,
-                     (UINT16)(Address + WriteByte),
-                     AddressLen,
-                     (UINT16 *)((UINT8 *)Data + WriteByte),
-                     1
-                     );
-    WriteByte += DataWriteLen;
-    if (DataWriteLen != 1) {
-      DEBUG ((EFI_D_ERROR, "I2cWrite - partial write 1\n"));
-      return WriteByte;
-    }
+  if (MonzaxReadCached (Dev, Address, Data, DataLen)) {
+    return DataLen;
   }
 
-  return WriteByte;
+  if (FeaturePcdGet (PcdMonzaXMemoryCache) &&
+      (DataLen != 0) && ((UINTN) Address + DataLen <= GetMemorySize (Dev)) &&
+      FillCache (Dev, Address, DataLen)) {
+    CopyMem (Data, Dev->Cache + Address, DataLen);
+    return DataLen;
+  }
+  return ReadAdjustedAddress (Dev, Address, Data, DataLen);
 }
 
 /**
 
-  Write data to adjusted address.
+  Send the request of the first unit of a read from MonzaX chip, without
+  waiting for the data. The bridge moves the unit on the SMBus while the
+  caller serves other devices.
+
+  The request must be drained by MonzaxDrainRead() before anything else
+  uses the bridge of the device.
 
   @param Dev        Pointer to the MONZAX_DEV instance.
-  @param Address    The memory address to start writing to.
-  @param Data       The words to write.
-  @param DataLen    The number of words to write.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data, not 0.
+  @param Request    The request sent. Request->Unit.DataLen is the size of the unit.
 
-  @return The number of words written.
+  @retval EFI_SUCCESS       The request is sent.
+  @retval others            The request cannot be sent, and nothing is read.
 
 **/
-UINTN
-WriteAdjustedAddress (
-  IN MONZAX_DEV           *Dev,
-  IN UINT16               Address,
-  IN UINT16               *Data,
-  IN UINTN                DataLen
+EFI_STATUS
+MonzaxIssueRead (
+  IN  MONZAX_DEV           *Dev,
+  IN  UINT16               Address,
+  OUT UINT8                *Data,
+  IN  UINTN                DataLen,
+  OUT MONZAX_READ_REQUEST  *Request
   )
 {
-  UINTN      Count;
-  UINTN      Len;
-  UINT8      AddressLen;
-
-  // Handle dual address requirement of Monza X 2K Dura
+  EFI_STATUS           Status;
+  MONZAX_READ_SEGMENT  *Unit;
+
+  Request->ReadDataLen = 0;
+  Request->Complete    = FALSE;
+  Request->Issued      = FALSE;
+
+  Unit = &Request->Unit;
+  Unit->I2cDeviceId = Dev->MonzaxI2cDeviceId;
+  Unit->Address     = Address;
+  Unit->Data        = Data;
+  Unit->DataLen     = MIN (DataLen, CP2112_DATA_READ_MAX_LENGTH);
+
+  //
+  // As in ReadAdjustedAddress(), the upper half of a 2K Dura answers at the
+  // next slave address, so a unit stops at the boundary.
+  //
   if (Dev->ChipModelType == MonzaX2KDura) {
-    AddressLen = 1;
-
-    // Is the supplied address larger than a byte?
-    // If so, change the device id and adjust the address.
-    // The lower bit of the device id is the upper bit of the address.
+    Unit->AddressLen = 1;
     if (Address > 0xFF) {
-      Dev->MonzaxI2cDeviceId ++;
-      Address -= 0x0100;
-      Count = I2cWrite (Dev, Address, AddressLen, Data, DataLen);
-      Dev->MonzaxI2cDeviceId --;
-    }
-    // Will the write operation cross the address boundary (0xFF)?
-    // If  so, write the data in two chunks. This prevents addressing
-    // problems if the end user has implemented i2c_write using a
-    // single word write.
-    else if (Address + (DataLen - 1) > 0xFF) {
-      Len = 0xFF - Address + 1;
-      Count = I2cWrite (Dev, Address, AddressLen, Data, Len);
-      Dev->MonzaxI2cDeviceId ++;
-      Count += I2cWrite (Dev, (UINT16)(Address + Len), AddressLen, Data + Len, DataLen - Len);
-      Dev->MonzaxI2cDeviceId --;
+      Unit->I2cDeviceId = (UINT8)(Unit->I2cDeviceId + 1);
+      Unit->Address     = (UINT16)(Address - 0x0100);
+    } else {
+      Unit->DataLen = MIN (Unit->DataLen, 0x100 - (UINTN)Address);
     }
-    // Regular write operation.
-    else {
-      Count = I2cWrite(Dev, Address, AddressLen, Data, DataLen);
+  } else {
+    Unit->AddressLen = 2;
+  }
+
+  Status = SelectMuxChannel (Dev);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Request->TraceStart = MONZAX_TRACE_BEGIN ();
+  Request->Start = GetPerformanceCounter ();
+
+  Status = CheckBridgeReady (Dev);
+  if (!EFI_ERROR (Status)) {
+    Status = IssueReadRequest (Dev, Unit);
+    if (EFI_ERROR (Status)) {
+      CancelTransfer (Dev);
     }
   }
-  // Monza X 8K Dura. Regular write operation.
-  else {
-    AddressLen = 2;
-    Count = I2cWrite (Dev, Address, AddressLen, Data, DataLen);
+  Request->Issued = !EFI_ERROR (Status);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "MonzaxIssueRead - %r\n", Status));
+    Dev->ReadPointerValid = FALSE;
+    MonzaxRecordLatency (Dev, FALSE, Request->Start);
+    MONZAX_TRACE (Dev, MonzaXTraceI2cRead, Unit->I2cDeviceId, Unit->Address, 0, Status, Request->TraceStart);
   }
-  return Count;
+  return Status;
 }
 
 /**
 
-  Read data from adjusted address.
+  Drain the data of a request sent by MonzaxIssueRead().
 
   @param Dev        Pointer to the MONZAX_DEV instance.
-  @param Address    The memory address to start reading from.
-  @param Data       A buffer of bytes to hold the data.
-  @param DataLen    The number of bytes to read.
+  @param Request    The request sent.
 
   @return  The number of bytes read.
 
 **/
 UINTN
-ReadAdjustedAddress (
+MonzaxDrainRead (
   IN MONZAX_DEV           *Dev,
-  IN UINT16               Address,
-  OUT UINT8               *Data,
-  IN UINTN                DataLen
+  IN MONZAX_READ_REQUEST  *Request
   )
 {
-  UINTN      Count;
-  UINT8      AddressLen;
-  UINTN      Len;
-
-  // Handle dual address requirement of Monza X 2K Dura
-  if (Dev->ChipModelType == MonzaX2KDura) {
-    AddressLen = 1;
-
-    // Is the supplied address larger than a byte?
-    // If so, change the device id and adjust the address.
-    // The lower bit of the device id is the upper bit of the address.
-    if (Address > 0xFF) {
-      Dev->MonzaxI2cDeviceId ++;
-      Address -= 0x0100;
-      Count = I2cRead (Dev, Address, AddressLen, Data, DataLen);
-      Dev->MonzaxI2cDeviceId --;
-    }
-    // Will the read operation cross the address boundary (0xFF)?
-    // If  so, read the data in two chunks. This prevents addressing
-    // problems if the end user has implemented i2c_read using a
-    // single byte read.
-    else if (Address + (DataLen - 1) > 0xFF) {
-      Len = 0xFF - Address + 1;
-      Count = I2cRead (Dev, Address, AddressLen, Data, Len);
+  EFI_STATUS           Status;
 
-      Dev->MonzaxI2cDeviceId ++;
-      Count += I2cRead (Dev, (UINT16)(Address + Len), AddressLen, Data + Len, DataLen - Len);
-      Dev->MonzaxI2cDeviceId --;
-    }
-    // Regular read operation.
-    else {
-      Count = I2cRead (Dev, Address, AddressLen, Data, DataLen);
-    }
-  }
-  // Monza X 8K Dura. Regular read operation.
-  else {
-    AddressLen = 2;
-    Count = I2cRead (Dev, Address, AddressLen, Data, DataLen);
+  Status = DrainReadUnit (Dev, Request, NULL);
+  Request->Issued = FALSE;
+  if (EFI_ERROR (Status)) {
+    DEBUG ((EFI_D_ERROR, "MonzaxDrainRead - partial read - %r\n", Status));
+    CancelTransfer (Dev);
   }
-
-  return Count;
+  MonzaxRecordLatency (Dev, FALSE, Request->Start);
+  MONZAX_TRACE (Dev, MonzaXTraceI2cRead, Request->Unit.I2cDeviceId, Request->Unit.Address, Request->ReadDataLen, Status, Request->TraceStart);
+  return Request->ReadDataLen;
 }
 
 /**
@@ -686,8 +1927,12 @@ MonzaxWriteAddress (
 {
   UINTN      Count;
   UINT8      *Ptr;
+  UINT16     StartAddress;
+  UINTN      StartLen;
 
   Count = 0;
+  StartAddress = Address;
+  StartLen = DataLen;
 
   // Copy the data pointer.
   Ptr = Data;
@@ -697,7 +1942,7 @@ MonzaxWriteAddress (
     UINT8 FirstWord[2];
     // Write does not start on a word boundary.
     // Read the previous byte.
-    ReadAdjustedAddress (Dev, Address - 1, FirstWord, 1);
+    MonzaxReadAddress (Dev, Address - 1, FirstWord, 1);
     // Append the previous byte with the first byte of data.
     // This is the first word. Write it to memory.
     FirstWord[1] = *Ptr;
@@ -708,13 +1953,13 @@ MonzaxWriteAddress (
     DataLen--;
   }
 
-  // Write one word at a time.
-  while (DataLen > 1) {
-    Count += WriteAdjustedAddress (Dev, Address, (UINT16*) Ptr, 1);
+  // Write all whole words at once. I2cWrite packs them per write page.
+  if (DataLen > 1) {
+    Count += WriteAdjustedAddress (Dev, Address, (UINT16*) Ptr, DataLen / 2);
     // Adjust the address, data pointer and length.
-    Address += 2;
-    DataLen -= 2;
-    Ptr += 2;
+    Address = (UINT16)(Address + (DataLen & ~(UINTN)1));
+    Ptr += DataLen & ~(UINTN)1;
+    DataLen &= 1;
   }
 
   // Handle partial word.
@@ -723,36 +1968,156 @@ MonzaxWriteAddress (
     // Write does not end on a word boundary.
     // Read the next byte.
     LastWord[0] = *Ptr;
-    ReadAdjustedAddress (Dev, Address + 1, LastWord + 1, 1);
+    MonzaxReadAddress (Dev, Address + 1, LastWord + 1, 1);
     // This is the last word. Write it.
     Count += WriteAdjustedAddress (Dev, Address, (UINT16 *) LastWord, 1);
   }
 
+  if (FeaturePcdGet (PcdMonzaXMemoryCache)) {
+    UpdateCache (Dev, StartAddress, Data, StartLen, (BOOLEAN)(Count * 2 >= (StartAddress & 1) + StartLen));
+  }
+
   // Count is in words. Return bytes.
   return Count * 2;
 }
 
 /**
 
-  Read data from MonzaX chip.
+  Read the CP2112 SMBus configuration feature report.
 
   @param Dev        Pointer to the MONZAX_DEV instance.
-  @param Address    The device address of MonzaX chip on where the data is read from.
-  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
-  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+  @param Config     The buffer to hold the configuration.
 
-  @return  The amount of data actually transferred.
+  @return the status of the HID GET_REPORT request.
+
+**/
+EFI_STATUS
+GetSmbusConfig (
+  IN MONZAX_DEV                         *Dev,
+  OUT CP2112_SMBUS_CONFIGURATION_STRUCT *Config
+  )
+{
+  EFI_STATUS           Status;
+
+  ZeroMem (Config, sizeof(*Config));
+  Status = UsbGetReportRequest (
+             Dev->UsbIo,
+             Dev->InterfaceDescriptor.InterfaceNumber,
+             CP2112_GET_SET_SMBUS_CONFIGURATION,
+             HID_FEATURE_REPORT,
+             sizeof(*Config),
+             (UINT8 *)Config
+             );
+  DEBUG ((EFI_D_INFO, "GetSmbusConfig - %r\n", Status));
+  return Status;
+}
+
+/**
+
+  Program the CP2112 SMBus configuration from the PCDs.
+
+  The active configuration is read back into Dev->SmbusConfig.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS       The configuration is programmed.
+  @retval others            The configuration cannot be read or written.
+
+**/
+EFI_STATUS
+ConfigureSmbus (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  EFI_STATUS                         Status;
+  CP2112_SMBUS_CONFIGURATION_STRUCT  Config;
+
+  //
+  // Start from the current values, so the fields without a PCD are kept.
+  //
+  Status = GetSmbusConfig (Dev, &Config);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  CopyMem (&Dev->SmbusConfig, &Config, sizeof(Config));
+
+  Config.ReportId      = CP2112_GET_SET_SMBUS_CONFIGURATION;
+  Config.ClockSpeed    = SwapBytes32 (MIN (PcdGet32 (PcdMonzaXUsbSmbusClockSpeed), CP2112_SMBUS_CLOCK_SPEED_MAX));
+  Config.WriteTimeout  = SwapBytes16 (MIN (PcdGet16 (PcdMonzaXUsbSmbusWriteTimeout), CP2112_SMBUS_TIMEOUT_MAX));
+  Config.ReadTimeout   = SwapBytes16 (MIN (PcdGet16 (PcdMonzaXUsbSmbusReadTimeout), CP2112_SMBUS_TIMEOUT_MAX));
+  Config.SclLowTimeout = PcdGetBool (PcdMonzaXUsbSmbusSclLowTimeout) ? 1 : 0;
+  Config.RetryTime     = SwapBytes16 (MIN (PcdGet16 (PcdMonzaXUsbSmbusRetryLimit), CP2112_SMBUS_RETRY_TIME_MAX));
+  Config.AutoSendRead  = FeaturePcdGet (PcdMonzaXUsbAutoSendRead) ? 1 : 0;
+
+  Status = UsbSetReportRequest (
+             Dev->UsbIo,
+             Dev->InterfaceDescriptor.InterfaceNumber,
+             CP2112_GET_SET_SMBUS_CONFIGURATION,
+             HID_FEATURE_REPORT,
+             sizeof(Config),
+             (UINT8 *)&Config
+             );
+  DEBUG ((EFI_D_INFO, "ConfigureSmbus - %r\n", Status));
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Report what the bridge accepted, not what was asked for.
+  //
+  return GetSmbusConfig (Dev, &Dev->SmbusConfig);
+}
+
+/**
+
+  Read the TID of the chip for the probe, with the address layout of
+  Dev->ChipModelType.
+
+  @param Context    Pointer to the MONZAX_DEV instance.
+  @param Address    The memory address to start reading from.
+  @param Data       A buffer of bytes to hold the data.
+  @param DataLen    The number of bytes to read.
+
+  @return  The number of bytes read.
 
 **/
 UINTN
-MonzaxReadAddress (
-  IN MONZAX_DEV           *Dev,
-  IN UINT16               Address,
+EFIAPI
+MonzaxProbeRead (
+  IN  VOID                *Context,
+  IN  UINT16              Address,
   OUT UINT8               *Data,
-  IN UINTN                DataLen
+  IN  UINTN               DataLen
   )
 {
-  return ReadAdjustedAddress (Dev, Address, Data, DataLen);
+  return ReadAdjustedAddress ((MONZAX_DEV *) Context, Address, Data, DataLen);
+}
+
+/**
+
+  Start over the memory cache once the chip model is identified.
+
+  @param Context    Pointer to the MONZAX_DEV instance.
+  @param Status     EFI_SUCCESS if the chip model is identified.
+
+**/
+VOID
+EFIAPI
+MonzaxProbeComplete (
+  IN  VOID                *Context,
+  IN  EFI_STATUS          Status
+  )
+{
+  MONZAX_DEV           *Dev;
+
+  Dev = (MONZAX_DEV *) Context;
+  DEBUG ((EFI_D_INFO, "MonzaxProbe - 0x%02x: %r, model 0x%x\n", Dev->MonzaxI2cDeviceId, Status, Dev->ChipModelType));
+  if (EFI_ERROR (Status)) {
+    return;
+  }
+
+  MonzaxInvalidateCache (Dev, 0, 0);
+  MonzaxWarmUpCache (Dev);
 }
 
 /**
@@ -765,6 +2130,8 @@ MonzaxReadAddress (
   @retval EFI_SUCCESS            The MonzaX information structure is returned.
   @retval EFI_INVALID_PARAMETER  Info is NULL.
   @retval EFI_BUFFER_TOO_SMALL   The Info buffer is too small to hold the full data.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
+  @retval EFI_NOT_READY          The chip model is being identified by an interrupted caller.
 
 **/
 EFI_STATUS
@@ -774,6 +2141,7 @@ MonzaXIoGetInfo (
   IN OUT MONZAX_INFO                 *Info
   )
 {
+  EFI_STATUS           Status;
   MONZAX_DEV           *Dev;
 
   Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (This);
@@ -782,14 +2150,51 @@ MonzaXIoGetInfo (
     return EFI_INVALID_PARAMETER;
   }
 
-  if (Info->Length < sizeof(MONZAX_INFO)) {
+  if (Info->Length < MONZAX_INFO_REVISION_1_LENGTH) {
     Info->Length = sizeof(MONZAX_INFO);
     return EFI_BUFFER_TOO_SMALL;
   }
-  Info->Revision = MONZAX_INFO_REVISION;
-  Info->Length = sizeof(MONZAX_INFO);
+  EfiAcquireLock (&Dev->TransferLock);
+  // Report the detected model rather than the default one.
+  Status = MonzaxProbe (&Dev->Probe);
   Info->I2cDeviceId = Dev->MonzaxI2cDeviceId;
   Info->ChipModelType = Dev->ChipModelType;
+  EfiReleaseLock (&Dev->TransferLock);
+  if (EFI_ERROR (Status)) {
+    return (Status == EFI_NOT_READY) ? EFI_NOT_READY : EFI_DEVICE_ERROR;
+  }
+  if (Info->Length < MONZAX_INFO_REVISION_2_LENGTH) {
+    Info->Revision = MONZAX_INFO_REVISION_1;
+    Info->Length = MONZAX_INFO_REVISION_1_LENGTH;
+    return EFI_SUCCESS;
+  }
+  Info->BusFrequency = SwapBytes32 (Dev->SmbusConfig.ClockSpeed);
+  Info->WriteTimeout = SwapBytes16 (Dev->SmbusConfig.WriteTimeout);
+  Info->ReadTimeout = SwapBytes16 (Dev->SmbusConfig.ReadTimeout);
+  Info->RetryLimit = SwapBytes16 (Dev->SmbusConfig.RetryTime);
+  Info->SclLowTimeout = (BOOLEAN)(Dev->SmbusConfig.SclLowTimeout != 0);
+  if (Info->Length < MONZAX_INFO_REVISION_3_LENGTH) {
+    Info->Revision = MONZAX_INFO_REVISION_2;
+    Info->Length = MONZAX_INFO_REVISION_2_LENGTH;
+    return EFI_SUCCESS;
+  }
+  Info->CacheHits = Dev->CacheHits;
+  Info->CacheMisses = Dev->CacheMisses;
+  if (Info->Length < MONZAX_INFO_REVISION_4_LENGTH) {
+    Info->Revision = MONZAX_INFO_REVISION_3;
+    Info->Length = MONZAX_INFO_REVISION_3_LENGTH;
+    return EFI_SUCCESS;
+  }
+  Info->IoCalls = Dev->IoCallCount;
+  Info->BusTransfers = (UINT32) Dev->InterruptTransferCount;
+  if (Info->Length < sizeof(MONZAX_INFO)) {
+    Info->Revision = MONZAX_INFO_REVISION_4;
+    Info->Length = MONZAX_INFO_REVISION_4_LENGTH;
+    return EFI_SUCCESS;
+  }
+  Info->Revision = MONZAX_INFO_REVISION;
+  Info->Length = sizeof(MONZAX_INFO);
+  Info->MuxChannel = Dev->MuxChannel;
 
   return EFI_SUCCESS;
 }
@@ -803,6 +2208,7 @@ MonzaXIoGetInfo (
 
   @retval EFI_SUCCESS            The MonzaX information is set.
   @retval EFI_INVALID_PARAMETER  Info is NULL.
+  @retval EFI_INVALID_PARAMETER  Info->MuxChannel is not a channel of the multiplexer.
 
 **/
 EFI_STATUS
@@ -813,6 +2219,7 @@ MonzaXIoSetInfo (
   )
 {
   MONZAX_DEV           *Dev;
+  UINT8                MuxChannel;
 
   Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL(This);
 
@@ -820,11 +2227,32 @@ MonzaXIoSetInfo (
     return EFI_INVALID_PARAMETER;
   }
 
-  if (Info->Length < sizeof(MONZAX_INFO)) {
+  if (Info->Length < MONZAX_INFO_REVISION_1_LENGTH) {
     return EFI_BUFFER_TOO_SMALL;
   }
+  MuxChannel = Dev->MuxChannel;
+  if ((Info->Length >= sizeof(MONZAX_INFO)) && (Dev->MuxAddress != 0)) {
+    if (Info->MuxChannel >= MONZAX_MUX_CHANNEL_MAX) {
+      return EFI_INVALID_PARAMETER;
+    }
+    MuxChannel = Info->MuxChannel;
+  }
+
+  EfiAcquireLock (&Dev->TransferLock);
+  if ((Dev->MonzaxI2cDeviceId != Info->I2cDeviceId) || (Dev->ChipModelType != Info->ChipModelType) ||
+      (Dev->MuxChannel != MuxChannel)) {
+    MonzaxInvalidateCache (Dev, 0, 0);
+  }
   Dev->MonzaxI2cDeviceId = Info->I2cDeviceId;
   Dev->ChipModelType = Info->ChipModelType;
+  Dev->MuxChannel = MuxChannel;
+  Dev->ReadPointerValid = FALSE;
+
+  //
+  // The caller names the model, so there is nothing left to identify.
+  //
+  MonzaxProbeSetDone (&Dev->Probe);
+  EfiReleaseLock (&Dev->TransferLock);
 
   return EFI_SUCCESS;
 }
@@ -844,6 +2272,7 @@ MonzaXIoSetInfo (
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Read data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 EFI_STATUS
@@ -858,11 +2287,25 @@ MonzaXIoRead (
   MONZAX_DEV           *Dev;
   UINTN                TransferDataLen;
   UINTN                ExpectDataLen;
+  UINTN                TransferCount;
 
   Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (This);
+  PERF_START_EX (Dev->ControllerHandle, MONZAX_PERF_TOKEN_READ, NULL, 0, 0);
+  EfiAcquireLock (&Dev->TransferLock);
+  Dev->IoCallCount++;
+  if (EFI_ERROR (MonzaxProbe (&Dev->Probe))) {
+    EfiReleaseLock (&Dev->TransferLock);
+    PERF_END_EX (Dev->ControllerHandle, MONZAX_PERF_TOKEN_READ, NULL, 0, 0);
+    *DataLen = 0;
+    return EFI_DEVICE_ERROR;
+  }
   ExpectDataLen = *DataLen;
+  TransferCount = Dev->InterruptTransferCount;
   TransferDataLen = MonzaxReadAddress (Dev, Address, Data, *DataLen);
+  EfiReleaseLock (&Dev->TransferLock);
+  PERF_END_EX (Dev->ControllerHandle, MONZAX_PERF_TOKEN_READ, NULL, 0, 0);
   *DataLen = TransferDataLen;
+  DEBUG ((EFI_D_INFO, "MonzaXIoRead - 0x%x bytes, 0x%x interrupt transfers\n", TransferDataLen, Dev->InterruptTransferCount - TransferCount));
   if (TransferDataLen == 0) {
     return EFI_DEVICE_ERROR;
   } else {
@@ -886,6 +2329,7 @@ MonzaXIoRead (
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Write data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 EFI_STATUS
@@ -900,11 +2344,25 @@ MonzaXIoWrite (
   MONZAX_DEV           *Dev;
   UINTN                TransferDataLen;
   UINTN                ExpectDataLen;
+  UINTN                TransferCount;
 
   Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (This);
+  PERF_START_EX (Dev->ControllerHandle, MONZAX_PERF_TOKEN_WRITE, NULL, 0, 0);
+  EfiAcquireLock (&Dev->TransferLock);
+  Dev->IoCallCount++;
+  if (EFI_ERROR (MonzaxProbe (&Dev->Probe))) {
+    EfiReleaseLock (&Dev->TransferLock);
+    PERF_END_EX (Dev->ControllerHandle, MONZAX_PERF_TOKEN_WRITE, NULL, 0, 0);
+    *DataLen = 0;
+    return EFI_DEVICE_ERROR;
+  }
   ExpectDataLen = *DataLen;
+  TransferCount = Dev->InterruptTransferCount;
   TransferDataLen = MonzaxWriteAddress (Dev, Address, Data, *DataLen);
+  EfiReleaseLock (&Dev->TransferLock);
+  PERF_END_EX (Dev->ControllerHandle, MONZAX_PERF_TOKEN_WRITE, NULL, 0, 0);
   *DataLen = TransferDataLen;
+  DEBUG ((EFI_D_INFO, "MonzaXIoWrite - 0x%x bytes, 0x%x interrupt transfers\n", TransferDataLen, Dev->InterruptTransferCount - TransferCount));
   if (TransferDataLen == 0) {
     return EFI_DEVICE_ERROR;
   } else {
@@ -912,3 +2370,105 @@ MonzaXIoWrite (
     return EFI_SUCCESS;
   }
 }
+
+/**
+
+  Start reading data from MonzaX chip.
+
+  The CP2112 transport is synchronous, so the read is done before this
+  returns and Token->Event is signaled right away.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the read completes.
+
+  @retval EFI_SUCCESS            The read is done and Token is signaled.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoReadAsync (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  OUT UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  )
+{
+  if ((Data == NULL) || (DataLen == 0) || (Token == NULL) || (Token->Event == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Token->DataLength = DataLen;
+  Token->TransactionStatus = MonzaXIoRead (This, Address, Data, &Token->DataLength);
+  gBS->SignalEvent (Token->Event);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Start writing data to MonzaX chip.
+
+  The CP2112 transport is synchronous, so the write is done before this
+  returns and Token->Event is signaled right away.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is written to.
+  @param Data       A pointer to the buffer of data that will be written to MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the write completes.
+
+  @retval EFI_SUCCESS            The write is done and Token is signaled.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoWriteAsync (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  )
+{
+  if ((Data == NULL) || (DataLen == 0) || (Token == NULL) || (Token->Event == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Token->DataLength = DataLen;
+  Token->TransactionStatus = MonzaXIoWrite (This, Address, Data, &Token->DataLength);
+  gBS->SignalEvent (Token->Event);
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Drop cached MonzaX memory contents so that the next read goes to the chip.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of the first byte to drop.
+  @param DataLen    The number of bytes to drop. 0 drops the whole cache.
+
+  @retval EFI_SUCCESS            The range is no longer cached.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoInvalidateCache (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINTN                          DataLen
+  )
+{
+  MONZAX_DEV           *Dev;
+
+  Dev = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (This);
+  EfiAcquireLock (&Dev->TransferLock);
+  MonzaxInvalidateCache (Dev, Address, DataLen);
+  EfiReleaseLock (&Dev->TransferLock);
+  return EFI_SUCCESS;
+}
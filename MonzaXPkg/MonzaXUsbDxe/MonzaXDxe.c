@@ -34,10 +34,31 @@ EFI_DRIVER_BINDING_PROTOCOL gMonzaXDriverBinding = {
 };
 
 MONZAX_IO_PROTOCOL         mMonzaXIo = {
+  MONZAX_IO_PROTOCOL_REVISION,
   MonzaXIoGetInfo,
   MonzaXIoSetInfo,
   MonzaXIoRead,
-  MonzaXIoWrite
+  MonzaXIoWrite,
+  MonzaXIoReadAsync,
+  MonzaXIoWriteAsync,
+  MonzaXIoInvalidateCache
+};
+
+MONZAX_STATISTICS_PROTOCOL mMonzaXStatistics = {
+  MonzaXStatisticsGet,
+  MonzaXStatisticsReset
+};
+
+MONZAX_NOTIFY_PROTOCOL     mMonzaXNotify = {
+  MonzaXNotifyRegister,
+  MonzaXNotifyUnregister,
+  MonzaXNotifyGetState
+};
+
+MONZAX_SCHEDULER_PROTOCOL  mMonzaXScheduler = {
+  MonzaXSchedulerGetDevices,
+  MonzaXSchedulerSubmit,
+  MonzaXSchedulerRun
 };
 
 MONZAX_USB_INFO mMonzaXUsbInfo[] = {
@@ -49,7 +70,8 @@ MONZAX_USB_INFO mMonzaXUsbInfo[] = {
   Entrypoint of USB MonzaX Driver.
 
   This function is the entrypoint of USB MonzaX Driver. It installs Driver Binding
-  Protocols together with Component Name Protocols.
+  Protocols together with Component Name Protocols, and the MonzaX Scheduler
+  Protocol that runs work on all the devices of the driver.
 
   @param  ImageHandle       The firmware allocated handle for the EFI image.
   @param  SystemTable       A pointer to the EFI System Table.
@@ -76,6 +98,14 @@ MonzaXUsbDriverBindingEntryPoint (
              );
   ASSERT_EFI_ERROR (Status);
 
+  Status = gBS->InstallProtocolInterface (
+                  &ImageHandle,
+                  &gMonzaXSchedulerProtocolGuid,
+                  EFI_NATIVE_INTERFACE,
+                  &mMonzaXScheduler
+                  );
+  ASSERT_EFI_ERROR (Status);
+
   return EFI_SUCCESS;
 }
 
@@ -174,9 +204,9 @@ MonzaXDriverBindingStart (
   BOOLEAN                     FoundIn;
   BOOLEAN                     FoundOut;
   EFI_TPL                     OldTpl;
-  UINT8                       Result;
 
   DEBUG ((EFI_D_ERROR, "MonzaXDriverBindingStart: Enter\n"));
+  PERF_START_EX (Controller, MONZAX_PERF_TOKEN_START, NULL, 0, 0);
 
   MonzaXDevice = NULL;
 
@@ -216,10 +246,14 @@ MonzaXDriverBindingStart (
   ASSERT (MonzaXDevice != NULL);
 
   MonzaXDevice->Signature         = MONZAX_DEV_SIGNATURE;
+  EfiInitializeLock (&MonzaXDevice->TransferLock, TPL_CALLBACK);
   MonzaXDevice->UsbIo             = UsbIo;
   CopyMem (&MonzaXDevice->MonzaXIo, &mMonzaXIo, sizeof(mMonzaXIo));
+  CopyMem (&MonzaXDevice->StatisticsProtocol, &mMonzaXStatistics, sizeof(mMonzaXStatistics));
+  CopyMem (&MonzaXDevice->Notify, &mMonzaXNotify, sizeof(mMonzaXNotify));
   MonzaXDevice->DevicePath        = DevicePath;
   MonzaXDevice->ControllerHandle  = Controller;
+  MonzaxTraceInit (&MonzaXDevice->Trace);
 
   UsbIo->UsbGetDeviceDescriptor (
            UsbIo,
@@ -274,16 +308,56 @@ MonzaXDriverBindingStart (
     goto ErrorExit;
   }
 
-  DEBUG ((EFI_D_INFO, "MonzaxChipTest\n"));
-  // Hardcode
+  Status = ConfigureSmbus (MonzaXDevice);
+  if (EFI_ERROR (Status)) {
+    //
+    // The bridge still works with its power-on configuration.
+    //
+    DEBUG ((EFI_D_ERROR, "ConfigureSmbus - %r, use default configuration\n", Status));
+  }
+
+  if (FeaturePcdGet (PcdMonzaXUsbAsyncReceive)) {
+    Status = StartAsyncReceive (MonzaXDevice);
+    if (EFI_ERROR (Status)) {
+      //
+      // Fall back to synchronous interrupt transfers.
+      //
+      DEBUG ((EFI_D_ERROR, "StartAsyncReceive - %r, use sync transfer\n", Status));
+    }
+  }
+
+  //
+  // The model is identified later, off the boot path. Until then the
+  // chip is assumed to be an 8K Dura.
+  //
   MonzaXDevice->MonzaxI2cDeviceId = MONZAX_I2C_DEVICE_ID_DEFAULT;
   MonzaXDevice->ChipModelType = MonzaX8KDura;
-  Result = MonzaxChipTest (&MonzaXDevice->MonzaXIo);
-  if (Result == 0) {
-    DEBUG ((EFI_D_INFO, "MonzaxChipTest - PASS!\n"));
-  } else {
-    DEBUG ((EFI_D_INFO, "MonzaxChipTest - FAIL!\n"));
-    Status = EFI_UNSUPPORTED;
+
+  //
+  // Behind a multiplexer the chip is looked for on the lowest channel of
+  // the mask. SetInfo moves to another channel.
+  //
+  MonzaXDevice->MuxAddress = PcdGet8 (PcdMonzaXMuxAddress);
+  MonzaXDevice->MuxChannel = MONZAX_MUX_CHANNEL_NONE;
+  MonzaXDevice->MuxSelected = MONZAX_MUX_CHANNEL_NONE;
+  if (MonzaXDevice->MuxAddress != 0) {
+    for (Index = 0; Index < MONZAX_MUX_CHANNEL_MAX; Index++) {
+      if ((PcdGet8 (PcdMonzaXMuxChannelMask) & (1 << Index)) != 0) {
+        MonzaXDevice->MuxChannel = Index;
+        break;
+      }
+    }
+  }
+  Status = MonzaxProbeInit (
+             &MonzaXDevice->Probe,
+             &MonzaXDevice->ControllerHandle,
+             &MonzaXDevice->TransferLock,
+             &MonzaXDevice->ChipModelType,
+             MonzaxProbeRead,
+             MonzaxProbeComplete,
+             MonzaXDevice
+             );
+  if (EFI_ERROR (Status)) {
     goto ErrorExit;
   }
 
@@ -291,6 +365,10 @@ MonzaXDriverBindingStart (
                   &Controller,
                   &gMonzaXIoProtocolGuid,
                   &MonzaXDevice->MonzaXIo,
+                  &gMonzaXTraceProtocolGuid,
+                  &MonzaXDevice->Trace.Protocol,
+                  &gMonzaXStatisticsProtocolGuid,
+                  &MonzaXDevice->StatisticsProtocol,
                   NULL
                   );
 
@@ -298,6 +376,17 @@ MonzaXDriverBindingStart (
     goto ErrorExit;
   }
 
+  gBS->SetTimer (MonzaXDevice->Probe.Event, TimerRelative, MONZAX_PROBE_DELAY);
+  MonzaxSchedulerAddDevice (MonzaXDevice);
+
+  Status = MonzaxWakeGpioStart (MonzaXDevice);
+  if (EFI_ERROR (Status) && (Status != EFI_UNSUPPORTED)) {
+    //
+    // The chip is still usable, only the edge notification is missing.
+    //
+    DEBUG ((EFI_D_ERROR, "MonzaxWakeGpioStart - %r, no wake notification\n", Status));
+  }
+
   //
   // Open For Child Device
   //
@@ -321,6 +410,7 @@ MonzaXDriverBindingStart (
   gBS->RestoreTPL (OldTpl);
 
   DEBUG ((EFI_D_ERROR, "MonzaXDriverBindingStart: Exit\n"));
+  PERF_END_EX (Controller, MONZAX_PERF_TOKEN_START, NULL, 0, 0);
 
   return EFI_SUCCESS;
 
@@ -329,6 +419,13 @@ MonzaXDriverBindingStart (
 //
 ErrorExit:
   if (EFI_ERROR (Status)) {
+    if (MonzaXDevice != NULL) {
+      if (MonzaXDevice->Probe.Event != NULL) {
+        gBS->CloseEvent (MonzaXDevice->Probe.Event);
+      }
+      StopAsyncReceive (MonzaXDevice);
+    }
+
     gBS->CloseProtocol (
           Controller,
           &gEfiUsbIoProtocolGuid,
@@ -346,6 +443,7 @@ ErrorExit1:
   gBS->RestoreTPL (OldTpl);
 
   DEBUG ((EFI_D_ERROR, "MonzaXDriverBindingStart: Exit - %r\n", Status));
+  PERF_END_EX (Controller, MONZAX_PERF_TOKEN_START, NULL, 0, 0);
   return Status;
 }
 
@@ -391,16 +489,29 @@ MonzaXDriverBindingStop (
 
   MonzaXDevice = MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL (MonzaX);
 
+  Status = MonzaxWakeGpioStop (MonzaXDevice);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
   Status = gBS->UninstallMultipleProtocolInterfaces (
                   Controller,
                   &gMonzaXIoProtocolGuid,
                   &MonzaXDevice->MonzaXIo,
+                  &gMonzaXTraceProtocolGuid,
+                  &MonzaXDevice->Trace.Protocol,
+                  &gMonzaXStatisticsProtocolGuid,
+                  &MonzaXDevice->StatisticsProtocol,
                   NULL
                   );
   if (EFI_ERROR (Status)) {
     return Status;
   }
 
+  MonzaxSchedulerRemoveDevice (MonzaXDevice);
+  gBS->CloseEvent (MonzaXDevice->Probe.Event);
+  StopAsyncReceive (MonzaXDevice);
+
   gBS->CloseProtocol (
          Controller,
          &gEfiUsbIoProtocolGuid,
@@ -31,6 +31,10 @@ SOFTWARE.
 #include <Protocol/DevicePath.h>
 #include <Protocol/UsbIo.h>
 #include <Protocol/MonzaXIo.h>
+#include <Protocol/MonzaXTrace.h>
+#include <Protocol/MonzaXNotify.h>
+#include <Protocol/MonzaXScheduler.h>
+#include <Protocol/MonzaXStatistics.h>
 
 #include <Library/ReportStatusCodeLib.h>
 #include <Library/BaseMemoryLib.h>
@@ -40,12 +44,85 @@ SOFTWARE.
 #include <Library/MemoryAllocationLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/DebugLib.h>
+#include <Library/TimerLib.h>
+#include <Library/PcdLib.h>
+#include <Library/PerformanceLib.h>
+#include <Library/UefiUsbLib.h>
 #include <Library/MonzaXLib.h>
 
 #include "SiliconLabCP2112.h"
 
 #define MONZAX_DEV_SIGNATURE SIGNATURE_32 ('m', 'z', 'x', 'u')
 
+//
+// Outcome of the last transfer issued to the CP2112 bridge.
+//
+typedef enum {
+  MonzaXTransferStatusUnknown,  // error, timeout or unexpected report
+  MonzaXTransferStatusIdle,     // last transfer completed, bridge is idle
+  MonzaXTransferStatusPending   // write sent, completion not observed yet
+} MONZAX_TRANSFER_STATUS;
+
+//
+// Input reports buffered by the asynchronous interrupt IN transfer.
+//
+#define MONZAX_RECEIVE_RING_SIZE        16
+
+//
+// Interval, in microseconds, at which a consumer checks the receive ring.
+//
+#define MONZAX_RECEIVE_POLL_INTERVAL    100
+
+//
+// Delay before the asynchronous interrupt IN transfer is resubmitted after
+// an error.
+//
+#define MONZAX_RECEIVE_RECOVERY_DELAY   EFI_TIMER_PERIOD_MILLISECONDS (10)
+
+//
+// Adaptive timing of the transport. A report transfer times out after the
+// smoothed report latency plus four mean deviations plus the SMBus time of
+// the bytes the bridge moves meanwhile, within the bounds below, in ms.
+// A transfer status poll that finds the bridge busy backs off from
+// MONZAX_POLL_DELAY_MIN to MONZAX_POLL_DELAY_MAX, in us.
+//
+#define MONZAX_REPORT_TIMEOUT_MIN       20
+#define MONZAX_REPORT_TIMEOUT_MAX       3000
+#define MONZAX_POLL_DELAY_MIN           50
+#define MONZAX_POLL_DELAY_MAX           5000
+#define MONZAX_SMBUS_CLOCK_DEFAULT      100000
+
+typedef struct {
+  UINTN           Length;
+  UINT8           Data[CP2112_REPORT_SIZE];
+} MONZAX_REPORT;
+
+//
+// A contiguous read from one slave. The read engine issues it in units of at
+// most CP2112_DATA_READ_MAX_LENGTH bytes.
+//
+typedef struct {
+  UINT8           I2cDeviceId;
+  UINT16          Address;
+  UINT8           AddressLen;
+  UINT8           *Data;
+  UINTN           DataLen;
+} MONZAX_READ_SEGMENT;
+
+//
+// A read unit on its way through the bridge. Issued is set once its request
+// is sent, Complete once the bridge is done with it on the SMBus, and
+// ReadDataLen counts the bytes drained so far.
+//
+typedef struct {
+  MONZAX_READ_SEGMENT  Unit;
+  UINTN                ReadDataLen;
+  BOOLEAN              Issued;
+  BOOLEAN              Complete;
+  UINT64               Start;
+  UINT64               TraceStart;
+} MONZAX_READ_REQUEST;
+
 typedef struct {
   UINT16          IdVendor;
   UINT16          IdProduct;
@@ -58,9 +135,68 @@ typedef struct {
   UINT8           InterfaceProtocol;
 } MONZAX_USB_INFO;
 
+//
+// The memory cache is filled in blocks, with one valid bit per block.
+//
+#define MONZAX_CACHE_BLOCK_SIZE   64
+#define MONZAX_CACHE_BLOCK_COUNT  ((MONZAX_SIZE_BYTES_MEMORY_8K + MONZAX_CACHE_BLOCK_SIZE - 1) / MONZAX_CACHE_BLOCK_SIZE)
+
+//
+// Tokens of the PerformanceLib records of the driver, as shown by dp.
+// Start is recorded on the controller handle, the probe and every MonzaX IO
+// read and write on the handle of the MonzaX IO protocol.
+//
+#define MONZAX_PERF_TOKEN_START   "MonzaX:Start"
+#define MONZAX_PERF_TOKEN_READ    "MonzaX:Read"
+#define MONZAX_PERF_TOKEN_WRITE   "MonzaX:Write"
+
+//
+// A consumer event of the MonzaX Notify Protocol.
+//
+#define MONZAX_NOTIFY_ENTRY_SIGNATURE SIGNATURE_32 ('m', 'z', 'x', 'n')
+
+typedef struct {
+  UINTN           Signature;
+  LIST_ENTRY      Link;
+  EFI_EVENT       Event;
+} MONZAX_NOTIFY_ENTRY;
+
+#define MONZAX_NOTIFY_ENTRY_FROM_LINK(a) \
+    CR(a, MONZAX_NOTIFY_ENTRY, Link, MONZAX_NOTIFY_ENTRY_SIGNATURE)
+
+//
+// A read or write queued to a device by the MonzaX Scheduler Protocol.
+// Offset is the number of bytes already transferred. Request is the read
+// unit sent to the bridge whose data is not drained yet, if Request.Issued.
+//
+#define MONZAX_WORK_SIGNATURE SIGNATURE_32 ('m', 'z', 'x', 'w')
+
+typedef struct {
+  UINTN           Signature;
+  LIST_ENTRY      Link;
+  BOOLEAN         Write;
+  UINT16          Address;
+  UINT8           *Data;
+  UINTN           DataLen;
+  UINTN           Offset;
+  EFI_STATUS      Status;
+  MONZAX_IO_TOKEN *Token;
+  MONZAX_READ_REQUEST Request;
+} MONZAX_WORK;
+
+#define MONZAX_WORK_FROM_LINK(a) \
+    CR(a, MONZAX_WORK, Link, MONZAX_WORK_SIGNATURE)
+
 typedef struct {
   UINTN                         Signature;
 
+  //
+  // Entry in the device list of the scheduler, and the work queued to the
+  // device through it. Both are only changed under TransferLock.
+  //
+  LIST_ENTRY                    Link;
+  LIST_ENTRY                    WorkQueue;
+
   EFI_HANDLE                    ControllerHandle;
   EFI_DEVICE_PATH_PROTOCOL      *DevicePath;
 
@@ -70,18 +206,117 @@ typedef struct {
 
   UINT8                         MonzaxI2cDeviceId;
   MONZAX_CHIP_MODEL_TYPE        ChipModelType;
+  MONZAX_PROBE                  Probe;
+
+  //
+  // I2C multiplexer in front of the chip, MuxAddress is 0 if there is none.
+  // MuxSelected is the channel the multiplexer acknowledged last,
+  // MONZAX_MUX_CHANNEL_NONE when unknown, so that the select is only sent
+  // when MuxChannel changes.
+  //
+  UINT8                         MuxAddress;
+  UINT8                         MuxChannel;
+  UINT8                         MuxSelected;
+
+  //
+  // Transaction scope of the MonzaX IO calls and the probe timer. It is
+  // taken at TPL_CALLBACK, so MonzaX IO must not be called above that TPL.
+  //
+  EFI_LOCK                      TransferLock;
+
+  //
+  // Write-through cache of the chip memory, used when PcdMonzaXMemoryCache
+  // is TRUE. CacheGeneration changes on every invalidation, so a fill that
+  // raced with one does not mark its blocks valid.
+  //
+  UINT8                         Cache[MONZAX_SIZE_BYTES_MEMORY_8K];
+  UINT32                        CacheValid;
+  UINT32                        CacheGeneration;
+  UINT32                        CacheHits;
+  UINT32                        CacheMisses;
+
+  //
+  // Internal address pointer of the chip, for current address reads when
+  // PcdMonzaXSequentialRead is TRUE. A read from ReadPointerSlave continues
+  // at ReadPointer. Writes and failed reads leave it unknown.
+  //
+  BOOLEAN                       ReadPointerValid;
+  UINT8                         ReadPointerSlave;
+  UINT16                        ReadPointer;
 
   EFI_USB_DEVICE_DESCRIPTOR     DeviceDescriptor;
   EFI_USB_INTERFACE_DESCRIPTOR  InterfaceDescriptor;
   EFI_USB_ENDPOINT_DESCRIPTOR   InEndpointDescriptor;
   EFI_USB_ENDPOINT_DESCRIPTOR   OutEndpointDescriptor;
 
+  CP2112_SMBUS_CONFIGURATION_STRUCT SmbusConfig;
+
+  MONZAX_TRANSFER_STATUS        TransferStatus;
+
+  //
+  // Smoothed latency of the input reports and its mean deviation, in us,
+  // less the SMBus time of the data they carry. 0 until the first report.
+  //
+  UINT32                        ReportLatency;
+  UINT32                        ReportLatencyDeviation;
+
+  UINT32                        IoCallCount;
+  UINTN                         InterruptTransferCount;
+
+  //
+  // Receive ring fed by the asynchronous interrupt IN transfer. The callback
+  // only advances ReceiveHead and consumers only advance ReceiveTail. After
+  // a transfer error ReceiveRecoveryEvent resubmits the transfer, or clears
+  // AsyncReceive if it cannot.
+  //
+  volatile BOOLEAN              AsyncReceive;
+  EFI_EVENT                     ReceiveRecoveryEvent;
+  MONZAX_REPORT                 ReceiveRing[MONZAX_RECEIVE_RING_SIZE];
+  volatile UINTN                ReceiveHead;
+  volatile UINTN                ReceiveTail;
+  UINTN                         ReceiveOverflowCount;
+
+  //
+  // Trace ring, with the MONZAX_TRACE_PROTOCOL of the device.
+  //
+  MONZAX_TRACE_RING             Trace;
+
+  //
+  // Bus statistics, from the transfer status responses of the bridge and
+  // the latency of the reads and write units. Updated under TransferLock.
+  // StatusRecorded is set once the final status of the transfer issued
+  // last is counted, so that repeated polls of it are not.
+  //
+  MONZAX_STATISTICS_PROTOCOL    StatisticsProtocol;
+  MONZAX_STATISTICS             Statistics;
+  BOOLEAN                       StatusRecorded;
+
+  //
+  // Wake GPIO of the chip, sampled by WakeGpioEvent. The MonzaX Notify
+  // Protocol is installed only while WakeGpioEvent is not NULL.
+  //
+  MONZAX_NOTIFY_PROTOCOL        Notify;
+  LIST_ENTRY                    NotifyList;
+  EFI_EVENT                     WakeGpioEvent;
+  UINT8                         WakeGpio;
+  BOOLEAN                       WakeLevel;
+  UINT32                        WakeEdgeCount;
+
   EFI_UNICODE_STRING_TABLE      *ControllerNameTable;
 } MONZAX_DEV;
 
 #define MONZAX_DEV_FROM_MONZAX_IO_PROTOCOL(a) \
     CR(a, MONZAX_DEV, MonzaXIo, MONZAX_DEV_SIGNATURE)
 
+#define MONZAX_DEV_FROM_MONZAX_NOTIFY_PROTOCOL(a) \
+    CR(a, MONZAX_DEV, Notify, MONZAX_DEV_SIGNATURE)
+
+#define MONZAX_DEV_FROM_MONZAX_STATISTICS_PROTOCOL(a) \
+    CR(a, MONZAX_DEV, StatisticsProtocol, MONZAX_DEV_SIGNATURE)
+
+#define MONZAX_DEV_FROM_LINK(a) \
+    CR(a, MONZAX_DEV, Link, MONZAX_DEV_SIGNATURE)
+
 extern EFI_DRIVER_BINDING_PROTOCOL  gMonzaXDriverBinding;
 extern EFI_COMPONENT_NAME_PROTOCOL  gMonzaXComponentName;
 extern EFI_COMPONENT_NAME2_PROTOCOL gMonzaXComponentName2;
@@ -304,6 +539,7 @@ MonzaXIoGetInfo (
 
   @retval EFI_SUCCESS            The MonzaX information is set.
   @retval EFI_INVALID_PARAMETER  Info is NULL.
+  @retval EFI_INVALID_PARAMETER  Info->MuxChannel is not a channel of the multiplexer.
 
 **/
 EFI_STATUS
@@ -328,6 +564,7 @@ MonzaXIoSetInfo (
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Read data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 EFI_STATUS
@@ -354,6 +591,7 @@ MonzaXIoRead (
   @retval EFI_INVALID_PARAMETER  *DataLength is 0.
   @retval EFI_INVALID_PARAMETER  Data is NULL.
   @retval EFI_DEVICE_ERROR       Write data fail due to device error.
+  @retval EFI_DEVICE_ERROR       The chip model could not be identified.
 
 **/
 EFI_STATUS
@@ -367,16 +605,549 @@ MonzaXIoWrite (
 
 /**
 
-  This function dump raw data with colume format.
+  Start reading data from MonzaX chip.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the read completes.
+
+  @retval EFI_SUCCESS            The read is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+  @retval EFI_OUT_OF_RESOURCES   The request cannot be queued.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoReadAsync (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  OUT UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  );
+
+/**
+
+  Start writing data to MonzaX chip.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of MonzaX chip on where the data is written to.
+  @param Data       A pointer to the buffer of data that will be written to MonzaX device.
+  @param DataLength The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the write completes.
+
+  @retval EFI_SUCCESS            The write is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLength is 0.
+  @retval EFI_OUT_OF_RESOURCES   The request cannot be queued.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoWriteAsync (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  );
+
+/**
+
+  Drop cached MonzaX memory contents so that the next read goes to the chip.
+
+  @param This       Pointer to the MONZAX_IO_PROTOCOL instance.
+  @param Address    The device address of the first byte to drop.
+  @param DataLen    The number of bytes to drop. 0 drops the whole cache.
+
+  @retval EFI_SUCCESS            The range is no longer cached.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXIoInvalidateCache (
+  IN  MONZAX_IO_PROTOCOL             *This,
+  IN  UINT16                         Address,
+  IN  UINTN                          DataLen
+  );
+
+/**
+
+  Get the bus statistics of a MonzaX device.
+
+  @param This        Pointer to the MONZAX_STATISTICS_PROTOCOL instance.
+  @param Statistics  The buffer to hold the statistics.
+
+  @retval EFI_SUCCESS            The statistics are returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXStatisticsGet (
+  IN  MONZAX_STATISTICS_PROTOCOL     *This,
+  OUT MONZAX_STATISTICS              *Statistics
+  );
+
+/**
+
+  Set all the bus statistics of a MonzaX device to 0.
+
+  @param This        Pointer to the MONZAX_STATISTICS_PROTOCOL instance.
+
+  @retval EFI_SUCCESS            The statistics are cleared.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXStatisticsReset (
+  IN  MONZAX_STATISTICS_PROTOCOL     *This
+  );
+
+/**
+
+  Register an event to be signaled on every edge of the wake pin.
+
+  @param This       Pointer to the MONZAX_NOTIFY_PROTOCOL instance.
+  @param Event      The event to signal.
+
+  @retval EFI_SUCCESS            The event is registered.
+  @retval EFI_INVALID_PARAMETER  Event is NULL.
+  @retval EFI_ALREADY_STARTED    The event is already registered.
+  @retval EFI_OUT_OF_RESOURCES   The event cannot be registered.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXNotifyRegister (
+  IN  MONZAX_NOTIFY_PROTOCOL         *This,
+  IN  EFI_EVENT                      Event
+  );
+
+/**
+
+  Unregister an event registered by Register.
+
+  @param This       Pointer to the MONZAX_NOTIFY_PROTOCOL instance.
+  @param Event      The event to unregister.
+
+  @retval EFI_SUCCESS            The event is no longer signaled.
+  @retval EFI_NOT_FOUND          The event is not registered.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXNotifyUnregister (
+  IN  MONZAX_NOTIFY_PROTOCOL         *This,
+  IN  EFI_EVENT                      Event
+  );
+
+/**
+
+  Get the last sampled level of the wake pin.
+
+  @param This       Pointer to the MONZAX_NOTIFY_PROTOCOL instance.
+  @param Level      TRUE if the pin is high.
+  @param EdgeCount  Optional. The number of edges seen since start.
+
+  @retval EFI_SUCCESS            The state is returned.
+  @retval EFI_INVALID_PARAMETER  Level is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXNotifyGetState (
+  IN  MONZAX_NOTIFY_PROTOCOL         *This,
+  OUT BOOLEAN                        *Level,
+  OUT UINT32                         *EdgeCount OPTIONAL
+  );
+
+/**
+
+  Start watching the wake GPIO selected by PcdMonzaXUsbWakeGpio and install
+  the MonzaX Notify Protocol on the controller.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS       The wake GPIO is watched.
+  @retval EFI_UNSUPPORTED   No wake GPIO is configured.
+  @retval others            The GPIO cannot be set up.
+
+**/
+EFI_STATUS
+MonzaxWakeGpioStart (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Stop watching the wake GPIO and uninstall the MonzaX Notify Protocol.
+  The registered events are dropped, not signaled.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS       The wake GPIO is not watched.
+  @retval others            The MonzaX Notify Protocol cannot be uninstalled.
+
+**/
+EFI_STATUS
+MonzaxWakeGpioStop (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Get the MonzaX IO instances of the devices managed by the driver.
+
+  @param This         Pointer to the MONZAX_SCHEDULER_PROTOCOL instance.
+  @param DeviceCount  On input, the number of entries Devices can hold.
+                      On output, the number of devices.
+  @param Devices      The buffer to hold the MonzaX IO instances.
+
+  @retval EFI_SUCCESS            The devices are returned.
+  @retval EFI_INVALID_PARAMETER  DeviceCount is NULL, or Devices is NULL and *DeviceCount is not 0.
+  @retval EFI_BUFFER_TOO_SMALL   Devices cannot hold all the devices. *DeviceCount is updated.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXSchedulerGetDevices (
+  IN  MONZAX_SCHEDULER_PROTOCOL      *This,
+  IN OUT UINTN                       *DeviceCount,
+  OUT MONZAX_IO_PROTOCOL             **Devices
+  );
+
+/**
+
+  Queue a read or a write to the work queue of a device.
+
+  Nothing is transferred until Run is called. Data must stay valid until
+  Token->Event is signaled.
+
+  @param This       Pointer to the MONZAX_SCHEDULER_PROTOCOL instance.
+  @param MonzaXIo   The MonzaX IO instance of the device, from GetDevices.
+  @param Write      TRUE to write Data to the chip, FALSE to read into Data.
+  @param Address    The device address of MonzaX chip of the first byte.
+  @param Data       The data buffer.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the transfer completes.
+
+  @retval EFI_SUCCESS            The transfer is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLen is 0.
+  @retval EFI_NOT_FOUND          MonzaXIo is not a device of the driver.
+  @retval EFI_OUT_OF_RESOURCES   The transfer cannot be queued.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXSchedulerSubmit (
+  IN  MONZAX_SCHEDULER_PROTOCOL      *This,
+  IN  MONZAX_IO_PROTOCOL             *MonzaXIo,
+  IN  BOOLEAN                        Write,
+  IN  UINT16                         Address,
+  IN  UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  );
+
+/**
+
+  Run the work queues of all devices until they are empty.
+
+  @param This       Pointer to the MONZAX_SCHEDULER_PROTOCOL instance.
+
+  @retval EFI_SUCCESS            All queued transfers are completed.
+  @retval EFI_ALREADY_STARTED    Run is called from a token of a running Run.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXSchedulerRun (
+  IN  MONZAX_SCHEDULER_PROTOCOL      *This
+  );
+
+/**
+
+  Add a started device to the devices of the scheduler.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+MonzaxSchedulerAddDevice (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Remove a device from the devices of the scheduler. The queued work of the
+  device completes with EFI_ABORTED.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+MonzaxSchedulerRemoveDevice (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Read data from MonzaX chip, through the cache when it is enabled.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+
+  @return  The amount of data actually transferred.
+
+**/
+UINTN
+MonzaxReadAddress (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  OUT UINT8               *Data,
+  IN UINTN                DataLen
+  );
+
+/**
+
+  Send the request of the first unit of a read from MonzaX chip, without
+  waiting for the data. The request must be drained by MonzaxDrainRead()
+  before anything else uses the bridge of the device.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data, not 0.
+  @param Request    The request sent. Request->Unit.DataLen is the size of the unit.
+
+  @retval EFI_SUCCESS       The request is sent.
+  @retval others            The request cannot be sent, and nothing is read.
+
+**/
+EFI_STATUS
+MonzaxIssueRead (
+  IN  MONZAX_DEV           *Dev,
+  IN  UINT16               Address,
+  OUT UINT8                *Data,
+  IN  UINTN                DataLen,
+  OUT MONZAX_READ_REQUEST  *Request
+  );
+
+/**
+
+  Drain the data of a request sent by MonzaxIssueRead().
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Request    The request sent.
+
+  @return  The number of bytes read.
+
+**/
+UINTN
+MonzaxDrainRead (
+  IN MONZAX_DEV           *Dev,
+  IN MONZAX_READ_REQUEST  *Request
+  );
+
+/**
+
+  Serve a read from the cache, if the cache holds all of it.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of MonzaX chip on where the data is read from.
+  @param Data       A pointer to the buffer of data that will be read from MonzaX device.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+
+  @retval TRUE      The data is copied from the cache.
+  @retval FALSE     The cache is disabled or does not hold the whole range.
+
+**/
+BOOLEAN
+MonzaxReadCached (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  OUT UINT8               *Data,
+  IN UINTN                DataLen
+  );
+
+/**
+
+  Write data to MonzaX chip.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of MonzaX chip on where the data is written to.
+  @param Data       A pointer to the buffer of data that will be written to MonzaX device.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+
+  @return The amount of data actually transferred.
+
+**/
+UINTN
+MonzaxWriteAddress (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  IN UINT8                *Data,
+  IN UINTN                DataLen
+  );
+
+/**
+
+  Program the CP2112 SMBus configuration from the PCDs.
+
+  The active configuration is read back into Dev->SmbusConfig.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS       The configuration is programmed.
+  @retval others            The configuration cannot be read or written.
+
+**/
+EFI_STATUS
+ConfigureSmbus (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Start the asynchronous interrupt IN transfer that feeds the receive ring.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @return the status of UsbAsyncInterruptTransfer.
+
+**/
+EFI_STATUS
+StartAsyncReceive (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Timer notification that resubmits the asynchronous interrupt IN transfer
+  after an error. If it cannot be resubmitted, receives go back to
+  synchronous interrupt transfers.
+
+  @param Event      The recovery timer event.
+  @param Context    Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+EFIAPI
+AsyncReceiveRecovery (
+  IN EFI_EVENT            Event,
+  IN VOID                 *Context
+  );
+
+/**
+
+  Stop the asynchronous interrupt IN transfer that feeds the receive ring,
+  and its recovery.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+StopAsyncReceive (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Drop a range of the memory from the cache.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Address    The device address of the first byte.
+  @param DataLen    The number of bytes. 0 drops the whole cache.
+
+**/
+VOID
+MonzaxInvalidateCache (
+  IN MONZAX_DEV           *Dev,
+  IN UINT16               Address,
+  IN UINTN                DataLen
+  );
+
+/**
+
+  Fill the cache with the whole memory of the chip.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+MonzaxWarmUpCache (
+  IN MONZAX_DEV           *Dev
+  );
+
+/**
+
+  Read the TID of the chip for the probe, with the address layout of
+  Dev->ChipModelType.
+
+  @param Context    Pointer to the MONZAX_DEV instance.
+  @param Address    The memory address to start reading from.
+  @param Data       A buffer of bytes to hold the data.
+  @param DataLen    The number of bytes to read.
+
+  @return  The number of bytes read.
+
+**/
+UINTN
+EFIAPI
+MonzaxProbeRead (
+  IN  VOID                *Context,
+  IN  UINT16              Address,
+  OUT UINT8               *Data,
+  IN  UINTN               DataLen
+  );
+
+/**
+
+  Start over the memory cache once the chip model is identified.
+
+  @param Context    Pointer to the MONZAX_DEV instance.
+  @param Status     EFI_SUCCESS if the chip model is identified.
+
+**/
+VOID
+EFIAPI
+MonzaxProbeComplete (
+  IN  VOID                *Context,
+  IN  EFI_STATUS          Status
+  );
+
+/**
+
+  Count a transfer status response of the CP2112 into the statistics.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Response   The transfer status response.
+
+**/
+VOID
+MonzaxRecordTransferStatus (
+  IN MONZAX_DEV                              *Dev,
+  IN CP2112_TRANSFER_STATUS_RESPONSE_STRUCT  *Response
+  );
+
+/**
+
+  Count the latency of a read or a write into the statistics.
 
-  @param  Data  raw data
-  @param  Size  raw data size
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Write      TRUE for a write unit, FALSE for a read.
+  @param Start      The performance counter at the start of the transfer.
 
 **/
 VOID
-InternalDumpHex (
-  IN UINT8  *Data,
-  IN UINTN  Size
+MonzaxRecordLatency (
+  IN MONZAX_DEV           *Dev,
+  IN BOOLEAN              Write,
+  IN UINT64               Start
   );
 
 #endif
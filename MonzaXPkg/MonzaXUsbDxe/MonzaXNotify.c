@@ -0,0 +1,457 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+#include "MonzaXDxe.h"
+
+/**
+
+  Read the GPIO latch of the CP2112.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Latch      The level of the GPIOs, one bit per GPIO.
+
+  @return the status of UsbGetReportRequest.
+
+**/
+EFI_STATUS
+GetGpioLatch (
+  IN MONZAX_DEV           *Dev,
+  OUT UINT8               *Latch
+  )
+{
+  EFI_STATUS                 Status;
+  CP2112_GPIO_VALUES_STRUCT  Values;
+
+  ZeroMem (&Values, sizeof(Values));
+  Status = UsbGetReportRequest (
+             Dev->UsbIo,
+             Dev->InterfaceDescriptor.InterfaceNumber,
+             CP2112_GET_GPIO,
+             HID_FEATURE_REPORT,
+             sizeof(Values),
+             (UINT8 *)&Values
+             );
+  *Latch = Values.Latch;
+  return Status;
+}
+
+/**
+
+  Make the wake GPIO of the CP2112 an input without special function.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS       The GPIO is an input.
+  @retval others            The configuration cannot be read or written.
+
+**/
+EFI_STATUS
+ConfigureWakeGpio (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  EFI_STATUS                         Status;
+  CP2112_GPIO_CONFIGURATION_STRUCT   Config;
+  UINT8                              Mask;
+
+  ZeroMem (&Config, sizeof(Config));
+  Status = UsbGetReportRequest (
+             Dev->UsbIo,
+             Dev->InterfaceDescriptor.InterfaceNumber,
+             CP2112_GET_SET_GPIO_CONFIGURATION,
+             HID_FEATURE_REPORT,
+             sizeof(Config),
+             (UINT8 *)&Config
+             );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  //
+  // Keep the other pins as they are. The pin is an open-drain input, with
+  // the special function that shares it turned off.
+  //
+  Mask = (UINT8) (1 << Dev->WakeGpio);
+  Config.ReportId   = CP2112_GET_SET_GPIO_CONFIGURATION;
+  Config.Direction &= ~Mask;
+  Config.PushPull  &= ~Mask;
+  switch (Dev->WakeGpio) {
+  case 0:
+    Config.Special &= ~CP2112_GPIO_SPECIAL_TX_TOGGLE_GPIO0;
+    break;
+  case 1:
+    Config.Special &= ~CP2112_GPIO_SPECIAL_RX_TOGGLE_GPIO1;
+    break;
+  case 7:
+    Config.Special &= ~CP2112_GPIO_SPECIAL_CLOCK_GPIO7;
+    break;
+  default:
+    break;
+  }
+
+  Status = UsbSetReportRequest (
+             Dev->UsbIo,
+             Dev->InterfaceDescriptor.InterfaceNumber,
+             CP2112_GET_SET_GPIO_CONFIGURATION,
+             HID_FEATURE_REPORT,
+             sizeof(Config),
+             (UINT8 *)&Config
+             );
+  DEBUG ((EFI_D_INFO, "ConfigureWakeGpio - GPIO.%d %r\n", Dev->WakeGpio, Status));
+  return Status;
+}
+
+/**
+
+  Timer notification that samples the wake GPIO and signals the registered
+  events on an edge.
+
+  The CP2112 only reports the GPIO levels in a feature report, so the pin
+  is sampled every PcdMonzaXUsbWakeGpioInterval ms while at least one event
+  is registered. The consumers are only woken up on an edge.
+
+  @param Event      The wake GPIO timer event.
+  @param Context    Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+EFIAPI
+MonzaxWakeGpioNotify (
+  IN EFI_EVENT            Event,
+  IN VOID                 *Context
+  )
+{
+  MONZAX_DEV           *Dev;
+  EFI_STATUS           Status;
+  UINT8                Latch;
+  BOOLEAN              Level;
+  LIST_ENTRY           *Link;
+  MONZAX_NOTIFY_ENTRY  *Entry;
+
+  Dev = (MONZAX_DEV *) Context;
+  EfiAcquireLock (&Dev->TransferLock);
+
+  Status = GetGpioLatch (Dev, &Latch);
+  if (!EFI_ERROR (Status)) {
+    Level = (BOOLEAN) ((Latch & (1 << Dev->WakeGpio)) != 0);
+    if (Level != Dev->WakeLevel) {
+      Dev->WakeLevel = Level;
+      Dev->WakeEdgeCount++;
+
+      //
+      // The pin reports RF access to the chip, which may have changed the
+      // memory behind the cache.
+      //
+      MonzaxInvalidateCache (Dev, 0, 0);
+
+      for (Link = GetFirstNode (&Dev->NotifyList);
+           !IsNull (&Dev->NotifyList, Link);
+           Link = GetNextNode (&Dev->NotifyList, Link)) {
+        Entry = MONZAX_NOTIFY_ENTRY_FROM_LINK (Link);
+        gBS->SignalEvent (Entry->Event);
+      }
+    }
+  }
+
+  EfiReleaseLock (&Dev->TransferLock);
+}
+
+/**
+
+  Register an event to be signaled on every edge of the wake pin.
+
+  The first registration starts sampling the pin.
+
+  @param This       Pointer to the MONZAX_NOTIFY_PROTOCOL instance.
+  @param Event      The event to signal.
+
+  @retval EFI_SUCCESS            The event is registered.
+  @retval EFI_INVALID_PARAMETER  Event is NULL.
+  @retval EFI_ALREADY_STARTED    The event is already registered.
+  @retval EFI_OUT_OF_RESOURCES   The event cannot be registered.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXNotifyRegister (
+  IN  MONZAX_NOTIFY_PROTOCOL         *This,
+  IN  EFI_EVENT                      Event
+  )
+{
+  MONZAX_DEV           *Dev;
+  EFI_STATUS           Status;
+  LIST_ENTRY           *Link;
+  MONZAX_NOTIFY_ENTRY  *Entry;
+  UINT8                Latch;
+
+  if (Event == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Dev = MONZAX_DEV_FROM_MONZAX_NOTIFY_PROTOCOL (This);
+
+  Status = EFI_SUCCESS;
+  EfiAcquireLock (&Dev->TransferLock);
+  for (Link = GetFirstNode (&Dev->NotifyList);
+       !IsNull (&Dev->NotifyList, Link);
+       Link = GetNextNode (&Dev->NotifyList, Link)) {
+    Entry = MONZAX_NOTIFY_ENTRY_FROM_LINK (Link);
+    if (Entry->Event == Event) {
+      Status = EFI_ALREADY_STARTED;
+      goto Exit;
+    }
+  }
+
+  Entry = AllocatePool (sizeof(MONZAX_NOTIFY_ENTRY));
+  if (Entry == NULL) {
+    Status = EFI_OUT_OF_RESOURCES;
+    goto Exit;
+  }
+  Entry->Signature = MONZAX_NOTIFY_ENTRY_SIGNATURE;
+  Entry->Event     = Event;
+
+  if (IsListEmpty (&Dev->NotifyList)) {
+    //
+    // The pin was not sampled while nobody listened. Take the current level
+    // as the reference, so that an old change is not reported as an edge.
+    //
+    if (!EFI_ERROR (GetGpioLatch (Dev, &Latch))) {
+      Dev->WakeLevel = (BOOLEAN) ((Latch & (1 << Dev->WakeGpio)) != 0);
+    }
+    Status = gBS->SetTimer (
+                    Dev->WakeGpioEvent,
+                    TimerPeriodic,
+                    EFI_TIMER_PERIOD_MILLISECONDS (PcdGet32 (PcdMonzaXUsbWakeGpioInterval))
+                    );
+    if (EFI_ERROR (Status)) {
+      FreePool (Entry);
+      goto Exit;
+    }
+  }
+  InsertTailList (&Dev->NotifyList, &Entry->Link);
+
+Exit:
+  EfiReleaseLock (&Dev->TransferLock);
+  return Status;
+}
+
+/**
+
+  Unregister an event registered by Register.
+
+  Removing the last event stops sampling the pin.
+
+  @param This       Pointer to the MONZAX_NOTIFY_PROTOCOL instance.
+  @param Event      The event to unregister.
+
+  @retval EFI_SUCCESS            The event is no longer signaled.
+  @retval EFI_NOT_FOUND          The event is not registered.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXNotifyUnregister (
+  IN  MONZAX_NOTIFY_PROTOCOL         *This,
+  IN  EFI_EVENT                      Event
+  )
+{
+  MONZAX_DEV           *Dev;
+  LIST_ENTRY           *Link;
+  MONZAX_NOTIFY_ENTRY  *Entry;
+
+  Dev = MONZAX_DEV_FROM_MONZAX_NOTIFY_PROTOCOL (This);
+
+  EfiAcquireLock (&Dev->TransferLock);
+  for (Link = GetFirstNode (&Dev->NotifyList);
+       !IsNull (&Dev->NotifyList, Link);
+       Link = GetNextNode (&Dev->NotifyList, Link)) {
+    Entry = MONZAX_NOTIFY_ENTRY_FROM_LINK (Link);
+    if (Entry->Event == Event) {
+      RemoveEntryList (&Entry->Link);
+      if (IsListEmpty (&Dev->NotifyList)) {
+        gBS->SetTimer (Dev->WakeGpioEvent, TimerCancel, 0);
+      }
+      EfiReleaseLock (&Dev->TransferLock);
+      FreePool (Entry);
+      return EFI_SUCCESS;
+    }
+  }
+  EfiReleaseLock (&Dev->TransferLock);
+
+  return EFI_NOT_FOUND;
+}
+
+/**
+
+  Get the level of the wake pin.
+
+  While an event is registered this is the last sampled level, otherwise the
+  pin is read now.
+
+  @param This       Pointer to the MONZAX_NOTIFY_PROTOCOL instance.
+  @param Level      TRUE if the pin is high.
+  @param EdgeCount  Optional. The number of edges seen while an event was
+                    registered.
+
+  @retval EFI_SUCCESS            The state is returned.
+  @retval EFI_INVALID_PARAMETER  Level is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXNotifyGetState (
+  IN  MONZAX_NOTIFY_PROTOCOL         *This,
+  OUT BOOLEAN                        *Level,
+  OUT UINT32                         *EdgeCount OPTIONAL
+  )
+{
+  MONZAX_DEV           *Dev;
+  UINT8                Latch;
+
+  if (Level == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Dev = MONZAX_DEV_FROM_MONZAX_NOTIFY_PROTOCOL (This);
+
+  EfiAcquireLock (&Dev->TransferLock);
+  if (IsListEmpty (&Dev->NotifyList) &&
+      !EFI_ERROR (GetGpioLatch (Dev, &Latch))) {
+    Dev->WakeLevel = (BOOLEAN) ((Latch & (1 << Dev->WakeGpio)) != 0);
+  }
+  *Level = Dev->WakeLevel;
+  if (EdgeCount != NULL) {
+    *EdgeCount = Dev->WakeEdgeCount;
+  }
+  EfiReleaseLock (&Dev->TransferLock);
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Set up the wake GPIO selected by PcdMonzaXUsbWakeGpio and install the
+  MonzaX Notify Protocol on the controller. The pin is not sampled until the
+  first event is registered.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS       The wake GPIO is watched.
+  @retval EFI_UNSUPPORTED   No wake GPIO is configured.
+  @retval others            The GPIO cannot be set up.
+
+**/
+EFI_STATUS
+MonzaxWakeGpioStart (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  EFI_STATUS           Status;
+  UINT8                Latch;
+
+  InitializeListHead (&Dev->NotifyList);
+  Dev->WakeGpio = PcdGet8 (PcdMonzaXUsbWakeGpio);
+  if (Dev->WakeGpio >= CP2112_GPIO_COUNT) {
+    return EFI_UNSUPPORTED;
+  }
+
+  Status = ConfigureWakeGpio (Dev);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Status = GetGpioLatch (Dev, &Latch);
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+  Dev->WakeLevel = (BOOLEAN) ((Latch & (1 << Dev->WakeGpio)) != 0);
+  Dev->WakeEdgeCount = 0;
+
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  MonzaxWakeGpioNotify,
+                  Dev,
+                  &Dev->WakeGpioEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = gBS->InstallProtocolInterface (
+                  &Dev->ControllerHandle,
+                  &gMonzaXNotifyProtocolGuid,
+                  EFI_NATIVE_INTERFACE,
+                  &Dev->Notify
+                  );
+  if (EFI_ERROR (Status)) {
+    gBS->CloseEvent (Dev->WakeGpioEvent);
+    Dev->WakeGpioEvent = NULL;
+    return Status;
+  }
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Stop watching the wake GPIO and uninstall the MonzaX Notify Protocol.
+  The registered events are dropped, not signaled.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+  @retval EFI_SUCCESS       The wake GPIO is not watched.
+  @retval others            The MonzaX Notify Protocol cannot be uninstalled.
+
+**/
+EFI_STATUS
+MonzaxWakeGpioStop (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  EFI_STATUS           Status;
+  MONZAX_NOTIFY_ENTRY  *Entry;
+
+  if (Dev->WakeGpioEvent == NULL) {
+    return EFI_SUCCESS;
+  }
+
+  Status = gBS->UninstallProtocolInterface (
+                  Dev->ControllerHandle,
+                  &gMonzaXNotifyProtocolGuid,
+                  &Dev->Notify
+                  );
+  if (EFI_ERROR (Status)) {
+    return Status;
+  }
+
+  gBS->CloseEvent (Dev->WakeGpioEvent);
+  Dev->WakeGpioEvent = NULL;
+
+  while (!IsListEmpty (&Dev->NotifyList)) {
+    Entry = MONZAX_NOTIFY_ENTRY_FROM_LINK (GetFirstNode (&Dev->NotifyList));
+    RemoveEntryList (&Entry->Link);
+    FreePool (Entry);
+  }
+  return EFI_SUCCESS;
+}
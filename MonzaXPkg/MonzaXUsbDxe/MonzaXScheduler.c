@@ -0,0 +1,447 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+#include "MonzaXDxe.h"
+
+//
+// The devices managed by the driver, linked by MONZAX_DEV.Link. A device is
+// added and removed at TPL_CALLBACK, so the list is walked at TPL_CALLBACK
+// to keep a device from being stopped and freed under the walk.
+//
+LIST_ENTRY    mMonzaXDeviceList = INITIALIZE_LIST_HEAD_VARIABLE (mMonzaXDeviceList);
+
+//
+// Set while Run goes through the work queues.
+//
+BOOLEAN       mMonzaXSchedulerRunning = FALSE;
+
+/**
+
+  Add a started device to the devices of the scheduler.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+MonzaxSchedulerAddDevice (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  InitializeListHead (&Dev->WorkQueue);
+  InsertTailList (&mMonzaXDeviceList, &Dev->Link);
+}
+
+/**
+
+  Signal the tokens of completed work and free it.
+
+  @param WorkList   The list of completed MONZAX_WORK, emptied on return.
+
+**/
+VOID
+CompleteWork (
+  IN LIST_ENTRY           *WorkList
+  )
+{
+  MONZAX_WORK          *Work;
+
+  while (!IsListEmpty (WorkList)) {
+    Work = MONZAX_WORK_FROM_LINK (GetFirstNode (WorkList));
+    RemoveEntryList (&Work->Link);
+    Work->Token->TransactionStatus = Work->Status;
+    Work->Token->DataLength = Work->Offset;
+    gBS->SignalEvent (Work->Token->Event);
+    FreePool (Work);
+  }
+}
+
+/**
+
+  Remove a device from the devices of the scheduler. The queued work of the
+  device completes with EFI_ABORTED.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+
+**/
+VOID
+MonzaxSchedulerRemoveDevice (
+  IN MONZAX_DEV           *Dev
+  )
+{
+  LIST_ENTRY           Aborted;
+  MONZAX_WORK          *Work;
+
+  InitializeListHead (&Aborted);
+  EfiAcquireLock (&Dev->TransferLock);
+  RemoveEntryList (&Dev->Link);
+  while (!IsListEmpty (&Dev->WorkQueue)) {
+    Work = MONZAX_WORK_FROM_LINK (GetFirstNode (&Dev->WorkQueue));
+    RemoveEntryList (&Work->Link);
+    Work->Status = EFI_ABORTED;
+    InsertTailList (&Aborted, &Work->Link);
+  }
+  EfiReleaseLock (&Dev->TransferLock);
+
+  CompleteWork (&Aborted);
+}
+
+/**
+
+  Account for the bytes a step moved, and move the work to Done once it is
+  finished. The transfer lock of the device must be held.
+
+  @param Work       The work of the step.
+  @param Count      The number of bytes the step moved.
+  @param Length     The number of bytes the step was to move.
+  @param Done       The list of completed work.
+
+**/
+VOID
+AdvanceWork (
+  IN MONZAX_WORK          *Work,
+  IN UINTN                Count,
+  IN UINTN                Length,
+  IN LIST_ENTRY           *Done
+  )
+{
+  Work->Offset += MIN (Count, Length);
+
+  //
+  // As for MonzaX IO, a short transfer ends the work and only a transfer
+  // that moved no data at all is an error.
+  //
+  if (Count < Length) {
+    Work->Status = (Work->Offset == 0) ? EFI_DEVICE_ERROR : EFI_SUCCESS;
+  } else if (Work->Offset < Work->DataLen) {
+    return;
+  } else {
+    Work->Status = EFI_SUCCESS;
+  }
+  RemoveEntryList (&Work->Link);
+  InsertTailList (Done, &Work->Link);
+}
+
+/**
+
+  Start the next bus transfer of the first work of a device queue.
+
+  A write goes one write page at a time, which is one CP2112 DATA_WRITE,
+  and completes here once the bridge confirms it. A read sends the request
+  of one CP2112 read unit and leaves the data to FinishWorkStep(), unless
+  the cache holds the data.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Done       The list of completed work.
+
+  @retval TRUE      The queue of the device had work.
+  @retval FALSE     The queue of the device is empty.
+
+**/
+BOOLEAN
+RunWorkStep (
+  IN MONZAX_DEV           *Dev,
+  IN LIST_ENTRY           *Done
+  )
+{
+  MONZAX_WORK          *Work;
+  UINT16               Address;
+  UINTN                Length;
+  UINTN                Count;
+
+  EfiAcquireLock (&Dev->TransferLock);
+  if (IsListEmpty (&Dev->WorkQueue)) {
+    EfiReleaseLock (&Dev->TransferLock);
+    return FALSE;
+  }
+  Work = MONZAX_WORK_FROM_LINK (GetFirstNode (&Dev->WorkQueue));
+
+  if (Work->Offset == 0) {
+    Dev->IoCallCount++;
+    if (EFI_ERROR (MonzaxProbe (&Dev->Probe))) {
+      Work->Status = EFI_DEVICE_ERROR;
+      RemoveEntryList (&Work->Link);
+      InsertTailList (Done, &Work->Link);
+      EfiReleaseLock (&Dev->TransferLock);
+      return TRUE;
+    }
+  }
+
+  Address = (UINT16) (Work->Address + Work->Offset);
+  Length  = Work->DataLen - Work->Offset;
+  if (Work->Write) {
+    Length = MIN (Length, MONZAX_SIZE_BYTES_WRITE_PAGE - (Address % MONZAX_SIZE_BYTES_WRITE_PAGE));
+    Count = MonzaxWriteAddress (Dev, Address, Work->Data + Work->Offset, Length);
+  } else {
+    Length = MIN (Length, CP2112_DATA_READ_MAX_LENGTH);
+    if (MonzaxReadCached (Dev, Address, Work->Data + Work->Offset, Length)) {
+      Count = Length;
+    } else if (!EFI_ERROR (MonzaxIssueRead (Dev, Address, Work->Data + Work->Offset, Length, &Work->Request))) {
+      EfiReleaseLock (&Dev->TransferLock);
+      return TRUE;
+    } else {
+      Count = 0;
+    }
+  }
+  AdvanceWork (Work, Count, Length, Done);
+
+  EfiReleaseLock (&Dev->TransferLock);
+  return TRUE;
+}
+
+/**
+
+  Drain the read unit RunWorkStep() sent for the first work of a device
+  queue, if any.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Done       The list of completed work.
+
+**/
+VOID
+FinishWorkStep (
+  IN MONZAX_DEV           *Dev,
+  IN LIST_ENTRY           *Done
+  )
+{
+  MONZAX_WORK          *Work;
+  UINTN                Count;
+
+  EfiAcquireLock (&Dev->TransferLock);
+  if (!IsListEmpty (&Dev->WorkQueue)) {
+    Work = MONZAX_WORK_FROM_LINK (GetFirstNode (&Dev->WorkQueue));
+    if (Work->Request.Issued) {
+      Count = MonzaxDrainRead (Dev, &Work->Request);
+      AdvanceWork (Work, Count, Work->Request.Unit.DataLen, Done);
+    }
+  }
+  EfiReleaseLock (&Dev->TransferLock);
+}
+
+/**
+
+  Get the MonzaX IO instances of the devices managed by the driver.
+
+  @param This         Pointer to the MONZAX_SCHEDULER_PROTOCOL instance.
+  @param DeviceCount  On input, the number of entries Devices can hold.
+                      On output, the number of devices.
+  @param Devices      The buffer to hold the MonzaX IO instances.
+
+  @retval EFI_SUCCESS            The devices are returned.
+  @retval EFI_INVALID_PARAMETER  DeviceCount is NULL, or Devices is NULL and *DeviceCount is not 0.
+  @retval EFI_BUFFER_TOO_SMALL   Devices cannot hold all the devices. *DeviceCount is updated.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXSchedulerGetDevices (
+  IN  MONZAX_SCHEDULER_PROTOCOL      *This,
+  IN OUT UINTN                       *DeviceCount,
+  OUT MONZAX_IO_PROTOCOL             **Devices
+  )
+{
+  LIST_ENTRY           *Link;
+  UINTN                Count;
+  EFI_TPL              OldTpl;
+
+  if ((DeviceCount == NULL) || ((Devices == NULL) && (*DeviceCount != 0))) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Count = 0;
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  for (Link = GetFirstNode (&mMonzaXDeviceList);
+       !IsNull (&mMonzaXDeviceList, Link);
+       Link = GetNextNode (&mMonzaXDeviceList, Link)) {
+    if (Count < *DeviceCount) {
+      Devices[Count] = &MONZAX_DEV_FROM_LINK (Link)->MonzaXIo;
+    }
+    Count++;
+  }
+  gBS->RestoreTPL (OldTpl);
+
+  if (Count > *DeviceCount) {
+    *DeviceCount = Count;
+    return EFI_BUFFER_TOO_SMALL;
+  }
+  *DeviceCount = Count;
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Queue a read or a write to the work queue of a device.
+
+  Nothing is transferred until Run is called. Data must stay valid until
+  Token->Event is signaled.
+
+  @param This       Pointer to the MONZAX_SCHEDULER_PROTOCOL instance.
+  @param MonzaXIo   The MonzaX IO instance of the device, from GetDevices.
+  @param Write      TRUE to write Data to the chip, FALSE to read into Data.
+  @param Address    The device address of MonzaX chip of the first byte.
+  @param Data       The data buffer.
+  @param DataLen    The size, in bytes, of the data buffer specified by Data.
+  @param Token      The token signaled when the transfer completes.
+
+  @retval EFI_SUCCESS            The transfer is queued.
+  @retval EFI_INVALID_PARAMETER  Data or Token is NULL, Token->Event is NULL or DataLen is 0.
+  @retval EFI_NOT_FOUND          MonzaXIo is not a device of the driver.
+  @retval EFI_OUT_OF_RESOURCES   The transfer cannot be queued.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXSchedulerSubmit (
+  IN  MONZAX_SCHEDULER_PROTOCOL      *This,
+  IN  MONZAX_IO_PROTOCOL             *MonzaXIo,
+  IN  BOOLEAN                        Write,
+  IN  UINT16                         Address,
+  IN  UINT8                          *Data,
+  IN  UINTN                          DataLen,
+  IN  MONZAX_IO_TOKEN                *Token
+  )
+{
+  LIST_ENTRY           *Link;
+  MONZAX_DEV           *Dev;
+  MONZAX_WORK          *Work;
+  EFI_TPL              OldTpl;
+
+  if ((Data == NULL) || (DataLen == 0) || (Token == NULL) || (Token->Event == NULL)) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Work = AllocateZeroPool (sizeof(MONZAX_WORK));
+  if (Work == NULL) {
+    return EFI_OUT_OF_RESOURCES;
+  }
+  Work->Signature = MONZAX_WORK_SIGNATURE;
+  Work->Write     = Write;
+  Work->Address   = Address;
+  Work->Data      = Data;
+  Work->DataLen   = DataLen;
+  Work->Token     = Token;
+
+  //
+  // Only accept the devices of this driver, the MonzaX IO instance of
+  // another driver has no work queue. The device cannot be stopped until
+  // the work is on its queue.
+  //
+  Dev = NULL;
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  for (Link = GetFirstNode (&mMonzaXDeviceList);
+       !IsNull (&mMonzaXDeviceList, Link);
+       Link = GetNextNode (&mMonzaXDeviceList, Link)) {
+    if (&MONZAX_DEV_FROM_LINK (Link)->MonzaXIo == MonzaXIo) {
+      Dev = MONZAX_DEV_FROM_LINK (Link);
+      break;
+    }
+  }
+  if (Dev == NULL) {
+    gBS->RestoreTPL (OldTpl);
+    FreePool (Work);
+    return EFI_NOT_FOUND;
+  }
+
+  EfiAcquireLock (&Dev->TransferLock);
+  InsertTailList (&Dev->WorkQueue, &Work->Link);
+  EfiReleaseLock (&Dev->TransferLock);
+  gBS->RestoreTPL (OldTpl);
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Run the work queues of all devices until they are empty.
+
+  The queues take turns, one bus transfer each. A round first sends the
+  read request of every device that reads, then drains them in turn, so
+  the bridges move their units on the SMBus at the same time. A write page
+  is confirmed before the next device gets its turn, but leaves the chip in
+  its write cycle, so by the time the turn of the device comes back the
+  wait of its next write has mostly passed.
+
+  @param This       Pointer to the MONZAX_SCHEDULER_PROTOCOL instance.
+
+  @retval EFI_SUCCESS            All queued transfers are completed.
+  @retval EFI_ALREADY_STARTED    Run is called from a token of a running Run.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXSchedulerRun (
+  IN  MONZAX_SCHEDULER_PROTOCOL      *This
+  )
+{
+  LIST_ENTRY           Done;
+  LIST_ENTRY           *Link;
+  LIST_ENTRY           *NextLink;
+  BOOLEAN              Busy;
+  EFI_TPL              OldTpl;
+
+  if (mMonzaXSchedulerRunning) {
+    return EFI_ALREADY_STARTED;
+  }
+  mMonzaXSchedulerRunning = TRUE;
+
+  InitializeListHead (&Done);
+  do {
+    Busy = FALSE;
+
+    //
+    // A step releases the transfer lock of its device, which would let a
+    // pending USB detach stop and free a device of the list. The round is
+    // held at TPL_CALLBACK, so that no device leaves the list under it.
+    //
+    OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+    for (Link = GetFirstNode (&mMonzaXDeviceList);
+         !IsNull (&mMonzaXDeviceList, Link);
+         Link = NextLink) {
+      NextLink = GetNextNode (&mMonzaXDeviceList, Link);
+      if (RunWorkStep (MONZAX_DEV_FROM_LINK (Link), &Done)) {
+        Busy = TRUE;
+      }
+    }
+
+    //
+    // Nothing else can use a bridge between its request and the drain: the
+    // round runs at TPL_CALLBACK, the TPL of the transfer locks.
+    //
+    for (Link = GetFirstNode (&mMonzaXDeviceList);
+         !IsNull (&mMonzaXDeviceList, Link);
+         Link = GetNextNode (&mMonzaXDeviceList, Link)) {
+      FinishWorkStep (MONZAX_DEV_FROM_LINK (Link), &Done);
+    }
+    gBS->RestoreTPL (OldTpl);
+
+    //
+    // The tokens are signaled between rounds, at the TPL of the caller, so
+    // that a notify function that submits work or stops a device does not
+    // change the device list under the round.
+    //
+    CompleteWork (&Done);
+  } while (Busy);
+
+  mMonzaXSchedulerRunning = FALSE;
+  return EFI_SUCCESS;
+}
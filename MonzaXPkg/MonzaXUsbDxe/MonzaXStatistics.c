@@ -0,0 +1,209 @@
+/** @file
+
+Copyright (c) 2016, Intel Corporation. All rights reserved.<BR>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the Software
+is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+
+**/
+
+#include "MonzaXDxe.h"
+
+/**
+
+  Get the histogram bucket of a value.
+
+  @param Value        The value.
+  @param BucketCount  The number of buckets of the histogram.
+
+  @return The bucket, see MONZAX_STATISTICS.
+
+**/
+UINTN
+GetHistogramBucket (
+  IN UINT32               Value,
+  IN UINTN                BucketCount
+  )
+{
+  if (Value == 0) {
+    return 0;
+  }
+  return MIN ((UINTN) HighBitSet32 (Value) + 1, BucketCount - 1);
+}
+
+/**
+
+  Count a transfer status response of the CP2112 into the statistics.
+
+  The retries are only counted once the transfer is over, the responses of
+  a busy bridge report a count that is still growing. The bridge repeats the
+  final status until the next transfer starts, so only the first COMPLETE
+  or ERROR response after a transfer is issued is counted.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Response   The transfer status response.
+
+**/
+VOID
+MonzaxRecordTransferStatus (
+  IN MONZAX_DEV                              *Dev,
+  IN CP2112_TRANSFER_STATUS_RESPONSE_STRUCT  *Response
+  )
+{
+  MONZAX_STATISTICS    *Statistics;
+  UINT16               Retries;
+
+  Statistics = &Dev->Statistics;
+  Retries = SwapBytes16 (Response->Status2);
+
+  switch (Response->Status0) {
+  case CP2112_TRANSFER_STATUS_RESPONSE_STATUS0_IDLE:
+    Statistics->StatusIdle++;
+    return;
+  case CP2112_TRANSFER_STATUS_RESPONSE_STATUS0_BUSY:
+    Statistics->StatusBusy++;
+    if (Response->Status1 == CP2112_TRANSFER_STATUS_RESPONSE_BUSY_STATUS1_ADDRESS_NACKED) {
+      Statistics->BusyAddressNacked++;
+    }
+    return;
+  case CP2112_TRANSFER_STATUS_RESPONSE_STATUS0_COMPLETE:
+    if (Dev->StatusRecorded) {
+      return;
+    }
+    Statistics->StatusComplete++;
+    break;
+  case CP2112_TRANSFER_STATUS_RESPONSE_STATUS0_ERROR:
+    if (Dev->StatusRecorded) {
+      return;
+    }
+    Statistics->StatusError++;
+    switch (Response->Status1) {
+    case CP2112_TRANSFER_STATUS_RESPONSE_ERROR_STATUS1_TIMEOUT_ADDRESS_NACKED:
+      Statistics->ErrorAddressNacked++;
+      break;
+    case CP2112_TRANSFER_STATUS_RESPONSE_ERROR_STATUS1_TIMEOUT_BUS_NOT_FREE:
+      Statistics->ErrorBusNotFree++;
+      break;
+    case CP2112_TRANSFER_STATUS_RESPONSE_ERROR_STATUS1_ARBITRATION_LOST:
+      Statistics->ErrorArbitrationLost++;
+      break;
+    case CP2112_TRANSFER_STATUS_RESPONSE_ERROR_STATUS1_READ_INCOMPLETE:
+      Statistics->ErrorReadIncomplete++;
+      break;
+    case CP2112_TRANSFER_STATUS_RESPONSE_ERROR_STATUS1_WRITE_INCOMPLETE:
+      Statistics->ErrorWriteIncomplete++;
+      break;
+    default:
+      break;
+    }
+    break;
+  default:
+    return;
+  }
+
+  Dev->StatusRecorded = TRUE;
+  Statistics->Retries += Retries;
+  Statistics->RetryHistogram[GetHistogramBucket (Retries, MONZAX_STATISTICS_RETRY_BUCKETS)]++;
+}
+
+/**
+
+  Count the latency of a read or a write into the statistics.
+
+  @param Dev        Pointer to the MONZAX_DEV instance.
+  @param Write      TRUE for a write unit, FALSE for a read.
+  @param Start      The performance counter at the start of the transfer.
+
+**/
+VOID
+MonzaxRecordLatency (
+  IN MONZAX_DEV           *Dev,
+  IN BOOLEAN              Write,
+  IN UINT64               Start
+  )
+{
+  UINT32               Latency;
+  UINTN                Bucket;
+
+  Latency = (UINT32) DivU64x32 (GetTimeInNanoSecond (MonzaxGetElapsedTicks (&Dev->Trace, Start, GetPerformanceCounter ())), 1000);
+  Bucket = GetHistogramBucket (Latency, MONZAX_STATISTICS_LATENCY_BUCKETS);
+  if (Write) {
+    Dev->Statistics.WriteLatencyHistogram[Bucket]++;
+  } else {
+    Dev->Statistics.ReadLatencyHistogram[Bucket]++;
+  }
+}
+
+/**
+
+  Get the bus statistics of a MonzaX device.
+
+  @param This        Pointer to the MONZAX_STATISTICS_PROTOCOL instance.
+  @param Statistics  The buffer to hold the statistics.
+
+  @retval EFI_SUCCESS            The statistics are returned.
+  @retval EFI_INVALID_PARAMETER  Statistics is NULL.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXStatisticsGet (
+  IN  MONZAX_STATISTICS_PROTOCOL     *This,
+  OUT MONZAX_STATISTICS              *Statistics
+  )
+{
+  MONZAX_DEV           *Dev;
+
+  if (Statistics == NULL) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  Dev = MONZAX_DEV_FROM_MONZAX_STATISTICS_PROTOCOL (This);
+
+  EfiAcquireLock (&Dev->TransferLock);
+  CopyMem (Statistics, &Dev->Statistics, sizeof(MONZAX_STATISTICS));
+  EfiReleaseLock (&Dev->TransferLock);
+
+  return EFI_SUCCESS;
+}
+
+/**
+
+  Set all the bus statistics of a MonzaX device to 0.
+
+  @param This        Pointer to the MONZAX_STATISTICS_PROTOCOL instance.
+
+  @retval EFI_SUCCESS            The statistics are cleared.
+
+**/
+EFI_STATUS
+EFIAPI
+MonzaXStatisticsReset (
+  IN  MONZAX_STATISTICS_PROTOCOL     *This
+  )
+{
+  MONZAX_DEV           *Dev;
+
+  Dev = MONZAX_DEV_FROM_MONZAX_STATISTICS_PROTOCOL (This);
+
+  EfiAcquireLock (&Dev->TransferLock);
+  ZeroMem (&Dev->Statistics, sizeof(MONZAX_STATISTICS));
+  EfiReleaseLock (&Dev->TransferLock);
+
+  return EFI_SUCCESS;
+}
@@ -63,6 +63,60 @@ SOFTWARE.
 
 // NOTE: All below data structure is BIG ENDIEN.
 
+//
+// Every interrupt report exchanged with the CP2112 is at most 64 bytes.
+//
+#define CP2112_REPORT_SIZE                   0x40
+
+//
+// SMBus configuration feature report. Multi-byte fields are big endian.
+//
+#define CP2112_SMBUS_CLOCK_SPEED_MAX         400000
+#define CP2112_SMBUS_TIMEOUT_MAX             1000
+#define CP2112_SMBUS_RETRY_TIME_MAX          1000
+typedef struct {
+  UINT8    ReportId;
+  UINT32   ClockSpeed;
+  UINT8    DeviceAddress;
+  UINT8    AutoSendRead;
+  UINT16   WriteTimeout;
+  UINT16   ReadTimeout;
+  UINT8    SclLowTimeout;
+  UINT16   RetryTime;
+} CP2112_SMBUS_CONFIGURATION_STRUCT;
+
+//
+// GPIO configuration feature report. Direction and PushPull take one bit per
+// GPIO, a set Direction bit makes the pin an output. Special enables the
+// alternate function of GPIO.7 (clock output), GPIO.0 (TX toggle) and
+// GPIO.1 (RX toggle).
+//
+#define CP2112_GPIO_COUNT                    8
+#define CP2112_GPIO_SPECIAL_CLOCK_GPIO7      BIT0
+#define CP2112_GPIO_SPECIAL_TX_TOGGLE_GPIO0  BIT1
+#define CP2112_GPIO_SPECIAL_RX_TOGGLE_GPIO1  BIT2
+typedef struct {
+  UINT8    ReportId;
+  UINT8    Direction;
+  UINT8    PushPull;
+  UINT8    Special;
+  UINT8    ClockDivider;
+} CP2112_GPIO_CONFIGURATION_STRUCT;
+
+//
+// GPIO values feature report, one bit per GPIO.
+//
+typedef struct {
+  UINT8    ReportId;
+  UINT8    Latch;
+} CP2112_GPIO_VALUES_STRUCT;
+
+//
+// A single read or write-read request may ask for up to 512 bytes. The data
+// is returned in as many DATA_READ_RESPONSE reports as needed.
+//
+#define CP2112_DATA_READ_MAX_LENGTH          512
+
 typedef struct {
   UINT8    Command;
   UINT8    SlaveAddress;
@@ -86,18 +140,20 @@ typedef struct {
 #define CP2112_DATA_READ_RESPONSE_STATUS_BUSY      1
 #define CP2112_DATA_READ_RESPONSE_STATUS_COMPLETE  2
 #define CP2112_DATA_READ_RESPONSE_STATUS_ERROR     3
+#define CP2112_DATA_READ_RESPONSE_MAX_LENGTH       61
 typedef struct {
   UINT8    Command;
   UINT8    Status;
   UINT8    Length;
-  UINT8    Data[61];
+  UINT8    Data[CP2112_DATA_READ_RESPONSE_MAX_LENGTH];
 } CP2112_DATA_READ_RESPONSE_STRUCT;
 
+#define CP2112_DATA_WRITE_MAX_LENGTH  61
 typedef struct {
   UINT8    Command;
   UINT8    SlaveAddress;
   UINT8    Length;
-  UINT8    Data[61];
+  UINT8    Data[CP2112_DATA_WRITE_MAX_LENGTH];
 } CP2112_DATA_WRITE_STRUCT;
 
 #define CP2112_TRANSFER_STATUS_REQUEST_SMBUS_TRANSFER_STATUS     1